@@ -0,0 +1,128 @@
+// Cytosim was created by Francois Nedelec. Copyright 2007-2017 EMBL.
+
+#include "slab.h"
+#include "assert_macro.h"
+#include <new>
+#include <iomanip>
+
+
+Slab::Slab(std::string const& n)
+: name(n), chunks(0), nbChunks(0), cur(0), end(0), large(0)
+{
+    for ( size_t k = 0; k <= NB_SIZES; ++k )
+    {
+        freed[k] = 0;
+        used[k]  = 0;
+        spare[k] = 0;
+        calls[k] = 0;
+    }
+}
+
+
+Slab::~Slab()
+{
+    while ( chunks )
+    {
+        Chunk * c = chunks;
+        chunks = c->prev;
+        ::operator delete(c);
+    }
+}
+
+
+/**
+ The end of the previous chunk, if any, is lost
+ */
+void Slab::newChunk()
+{
+    Chunk * c = static_cast<Chunk*>(::operator new(CHUNK));
+    c->prev = chunks;
+    chunks = c;
+    ++nbChunks;
+    // the header of the chunk is padded to keep the slots aligned:
+    cur = reinterpret_cast<char*>(c) + ALIGN;
+    end = reinterpret_cast<char*>(c) + CHUNK;
+}
+
+
+void * Slab::allocate(const size_t s)
+{
+    size_t k = sizeClass(s);
+
+    if ( k > NB_SIZES )
+    {
+        ++large;
+        return ::operator new(s);
+    }
+
+    ++used[k];
+    ++calls[k];
+
+    if ( freed[k] )
+    {
+        Slot * x = freed[k];
+        freed[k] = x->next;
+        --spare[k];
+        return x;
+    }
+
+    size_t b = k * ALIGN;
+    if ( cur + b > end )
+        newChunk();
+
+    void * x = cur;
+    cur += b;
+    return x;
+}
+
+
+void Slab::release(void * ptr, const size_t s)
+{
+    if ( !ptr )
+        return;
+
+    size_t k = sizeClass(s);
+
+    if ( k > NB_SIZES )
+    {
+        ::operator delete(ptr);
+        return;
+    }
+
+    assert_true( used[k] > 0 );
+    --used[k];
+    ++spare[k];
+    Slot * x = static_cast<Slot*>(ptr);
+    x->next = freed[k];
+    freed[k] = x;
+}
+
+
+size_t Slab::nbUsed() const
+{
+    size_t res = 0;
+    for ( size_t k = 0; k <= NB_SIZES; ++k )
+        res += used[k];
+    return res;
+}
+
+
+void Slab::report(std::ostream& out) const
+{
+    out << "% slab " << name << ": " << nbChunks << " chunks of " << CHUNK << " bytes";
+    out << ", " << large << " large objects" << std::endl;
+    out << "%     size     used     free    calls   occupancy" << std::endl;
+    for ( size_t k = 1; k <= NB_SIZES; ++k )
+    {
+        if ( calls[k] )
+        {
+            size_t tot = used[k] + spare[k];
+            out << std::setw(10) << k * ALIGN;
+            out << " " << std::setw(8) << used[k];
+            out << " " << std::setw(8) << spare[k];
+            out << " " << std::setw(8) << calls[k];
+            out << " " << std::setw(10) << std::fixed << std::setprecision(3) << used[k] / double(tot);
+            out << std::endl;
+        }
+    }
+}
@@ -0,0 +1,117 @@
+// Cytosim was created by Francois Nedelec. Copyright 2007-2017 EMBL.
+
+#ifndef SLAB_H
+#define SLAB_H
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+
+
+/// Memory allocator for small objects that are frequently created and deleted
+/**
+ Slab allocates memory in large chunks, which are cut into slots in the order
+ of the requests. Objects created consecutively are thus contiguous in memory,
+ for example a Couple and its two Hands.
+ A released slot is recorded in a list corresponding to its size,
+ and it is reused for the next request of the same size.
+ The memory is only returned to the system when the Slab is destroyed.
+
+ Sizes are rounded up to a multiple of ALIGN bytes. Larger requests are
+ forwarded to the standard operator new.
+
+ A class can use a Slab by defining:
+ @code
+ static void * operator new(size_t s)          { return slab.allocate(s); }
+ static void   operator delete(void * p, size_t s) { slab.release(p, s); }
+ @endcode
+ where the size given to delete is the size of the dynamic type,
+ if the class has a virtual destructor.
+
+ This class is not thread-safe.
+ */
+class Slab
+{
+public:
+
+    /// granularity of the slot sizes, in bytes
+    static const size_t ALIGN = 16;
+
+    /// number of slot sizes managed
+    static const size_t NB_SIZES = 64;
+
+    /// size of the chunks, in bytes
+    static const size_t CHUNK = 1 << 16;
+
+private:
+
+    /// a released slot, linked into the list of free slots of its size
+    struct Slot { Slot * next; };
+
+    /// name used in report()
+    std::string name;
+
+    /// lists of free slots, indexed by size class
+    Slot *      freed[NB_SIZES+1];
+
+    /// number of slots in use for each size class
+    size_t      used[NB_SIZES+1];
+
+    /// number of free slots for each size class
+    size_t      spare[NB_SIZES+1];
+
+    /// number of requests, for each size class
+    size_t      calls[NB_SIZES+1];
+
+    /// a chunk, linked with the previously allocated ones
+    struct Chunk { Chunk * prev; };
+
+    /// the last allocated chunk
+    Chunk *     chunks;
+
+    /// number of chunks allocated
+    size_t      nbChunks;
+
+    /// unused part of the last chunk
+    char *      cur, * end;
+
+    /// number of requests that were forwarded to operator new
+    size_t      large;
+
+    /// size class corresponding to a request of `s` bytes
+    static size_t sizeClass(size_t s) { return ( s + ALIGN - 1 ) / ALIGN; }
+
+    /// allocate a new chunk
+    void        newChunk();
+
+    /// disabled copy constructor
+    Slab(Slab const&);
+
+    /// disabled assignment
+    Slab& operator = (Slab const&);
+
+public:
+
+    /// constructor
+    Slab(std::string const& n);
+
+    /// release all the memory
+    ~Slab();
+
+    /// return memory for an object of size `s`
+    void *      allocate(size_t s);
+
+    /// release the memory of an object of size `s`
+    void        release(void *, size_t s);
+
+    /// number of slots in use
+    size_t      nbUsed() const;
+
+    /// number of bytes allocated in chunks
+    size_t      nbBytes() const { return nbChunks * CHUNK; }
+
+    /// print the number of slots in use and free, for each size
+    void        report(std::ostream&) const;
+};
+
+#endif
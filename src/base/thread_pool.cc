@@ -0,0 +1,164 @@
+// Cytosim was created by Francois Nedelec. Copyright 2007-2017 EMBL.
+
+#include "thread_pool.h"
+#include "exceptions.h"
+
+
+ThreadPool POOL;
+
+
+ThreadPool::ThreadPool()
+{
+    nbThreads   = 1;
+    workers     = 0;
+    mGeneration = 0;
+    mPending    = 0;
+    mJob        = 0;
+    mArg        = 0;
+    mBusy       = false;
+    mQuit       = false;
+    pthread_mutex_init(&mMutex, 0);
+    pthread_cond_init(&mWake, 0);
+    pthread_cond_init(&mDone, 0);
+}
+
+
+ThreadPool::~ThreadPool()
+{
+    stop();
+    pthread_cond_destroy(&mDone);
+    pthread_cond_destroy(&mWake);
+    pthread_mutex_destroy(&mMutex);
+}
+
+
+void * ThreadPool::loop(void * arg)
+{
+    Worker * wrk = static_cast<Worker*>(arg);
+    ThreadPool * pool = wrk->pool;
+
+    // the generation was recorded before the thread was created,
+    // since a job may be started before this thread acquires the lock:
+    pthread_mutex_lock(&pool->mMutex);
+    unsigned long seen = wrk->generation;
+    while ( 1 )
+    {
+        while ( seen == pool->mGeneration  &&  !pool->mQuit )
+            pthread_cond_wait(&pool->mWake, &pool->mMutex);
+
+        if ( pool->mQuit )
+            break;
+
+        seen = pool->mGeneration;
+        Job job = pool->mJob;
+        void * job_arg = pool->mArg;
+        unsigned nbt = pool->nbThreads;
+        pthread_mutex_unlock(&pool->mMutex);
+
+        job(job_arg, wrk->rank, nbt);
+
+        pthread_mutex_lock(&pool->mMutex);
+        if ( --pool->mPending == 0 )
+            pthread_cond_signal(&pool->mDone);
+    }
+    pthread_mutex_unlock(&pool->mMutex);
+    return 0;
+}
+
+
+void ThreadPool::stop()
+{
+    if ( workers )
+    {
+        pthread_mutex_lock(&mMutex);
+        mQuit = true;
+        pthread_cond_broadcast(&mWake);
+        pthread_mutex_unlock(&mMutex);
+
+        for ( unsigned t = 1; t < nbThreads; ++t )
+            pthread_join(workers[t-1].thread, 0);
+
+        delete[] workers;
+        workers = 0;
+        mQuit = false;
+    }
+    nbThreads = 1;
+}
+
+
+/**
+ The calling thread is counted, and `n-1` new threads are created.
+ */
+void ThreadPool::resize(unsigned n)
+{
+    if ( n < 1 )
+        n = 1;
+
+    if ( n == nbThreads )
+        return;
+
+    pthread_mutex_lock(&mMutex);
+    bool busy = mBusy;
+    pthread_mutex_unlock(&mMutex);
+
+    if ( busy )
+        throw Exception("ThreadPool::resize() called while a job is running");
+
+    stop();
+
+    if ( n > 1 )
+    {
+        workers = new Worker[n-1];
+
+        for ( unsigned t = 1; t < n; ++t )
+        {
+            Worker & wrk = workers[t-1];
+            wrk.pool = this;
+            wrk.rank = t;
+            wrk.generation = mGeneration;
+            if ( pthread_create(&wrk.thread, 0, &loop, &wrk) )
+            {
+                // keep the threads that could be created:
+                n = t;
+                break;
+            }
+        }
+    }
+    nbThreads = n;
+}
+
+
+void ThreadPool::run(Job job, void * arg)
+{
+    if ( nbThreads < 2 )
+    {
+        job(arg, 0, 1);
+        return;
+    }
+
+    pthread_mutex_lock(&mMutex);
+    if ( mBusy )
+    {
+        // a nested call is executed by the calling thread alone:
+        pthread_mutex_unlock(&mMutex);
+        job(arg, 0, 1);
+        return;
+    }
+    mBusy    = true;
+    mJob     = job;
+    mArg     = arg;
+    mPending = nbThreads - 1;
+    ++mGeneration;
+    pthread_cond_broadcast(&mWake);
+    pthread_mutex_unlock(&mMutex);
+
+    // the calling thread does its part:
+    job(arg, 0, nbThreads);
+
+    pthread_mutex_lock(&mMutex);
+    while ( mPending > 0 )
+        pthread_cond_wait(&mDone, &mMutex);
+    mBusy = false;
+    pthread_mutex_unlock(&mMutex);
+}
+
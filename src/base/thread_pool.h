@@ -0,0 +1,125 @@
+// Cytosim was created by Francois Nedelec. Copyright 2007-2017 EMBL.
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <pthread.h>
+
+
+/// A fixed team of threads used to distribute independent pieces of work
+/**
+ ThreadPool holds ( size() - 1 ) POSIX threads, which are started by resize(),
+ and wait on a condition variable until run() is called.
+ The calling thread always takes part in the work with rank 0,
+ such that a pool of size 1 has no thread, and runs everything serially.
+
+ A job is a plain function, called once on each thread with its rank:
+ @code
+ void job(void * arg, unsigned rank, unsigned nbt)
+ {
+     unsigned start, end;
+     ThreadPool::partition(cnt, rank, nbt, start, end);
+     for ( unsigned i = start; i < end; ++i )
+         ...
+ }
+ POOL.run(job, arg);
+ @endcode
+ run() returns only after all threads have completed the job.
+
+ A job should not throw exceptions, and should not call run() recursively:
+ a nested call to run() is executed serially by the calling thread.
+ */
+class ThreadPool
+{
+public:
+
+    /// type of function executed by the threads
+    typedef void (*Job)(void * arg, unsigned rank, unsigned nbt);
+
+private:
+
+    /// information given to each thread
+    struct Worker
+    {
+        ThreadPool *  pool;
+        unsigned      rank;
+        pthread_t     thread;
+        unsigned long generation;  ///< last job seen by this thread
+    };
+
+    /// total number of threads, including the calling thread
+    unsigned         nbThreads;
+
+    /// array of workers of size ( nbThreads - 1 )
+    Worker *         workers;
+
+    /// lock protecting the variables below
+    pthread_mutex_t  mMutex;
+
+    /// signaled when a new job is available
+    pthread_cond_t   mWake;
+
+    /// signaled when the last worker has completed the job
+    pthread_cond_t   mDone;
+
+    /// incremented for each new job
+    unsigned long    mGeneration;
+
+    /// number of workers still busy with the current job
+    unsigned         mPending;
+
+    /// current job
+    Job              mJob;
+
+    /// argument of current job
+    void *           mArg;
+
+    /// true while a job is running, accessed only with the lock held
+    bool             mBusy;
+
+    /// if true, the workers will terminate
+    bool             mQuit;
+
+    /// the function executed by the workers
+    static void *    loop(void *);
+
+    /// stop and join all threads
+    void             stop();
+
+    /// Disabled copy constructor
+    ThreadPool(ThreadPool const&);
+
+    /// Disabled copy assignment
+    ThreadPool& operator = (ThreadPool const&);
+
+public:
+
+    /// create a pool of size 1 (no thread)
+    ThreadPool();
+
+    /// stop all threads
+    ~ThreadPool();
+
+    /// total number of threads, including the calling thread
+    unsigned size() const { return nbThreads; }
+
+    /// change the number of threads
+    void     resize(unsigned);
+
+    /// call `job(arg, rank, size())` on all threads and wait for completion
+    void     run(Job, void * arg);
+
+    /// set [start, end[ as the fraction of [0, cnt[ that should be processed by thread `rank`
+    static void partition(unsigned cnt, unsigned rank, unsigned nbt, unsigned& start, unsigned& end)
+    {
+        start = (unsigned)( ( (unsigned long)cnt * rank ) / nbt );
+        end   = (unsigned)( ( (unsigned long)cnt * ( rank+1 ) ) / nbt );
+    }
+};
+
+
+/// global instantiation used for multithreading
+extern ThreadPool POOL;
+
+#endif
+
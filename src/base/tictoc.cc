@@ -86,6 +86,22 @@ long TicToc::milli_seconds_today()
 }
 
 
+/**
+ This calls gettimeofday(), and can be used to time a section of code:
+ @code
+ double t = TicToc::milli_seconds();
+ ...
+ t = TicToc::milli_seconds() - t;
+ @endcode
+ */
+double TicToc::milli_seconds()
+{
+    struct timeval now;
+    gettimeofday(&now, 0);
+    return now.tv_sec * 1e3 + now.tv_usec * 1e-3;
+}
+
+
 #pragma mark CPU time
 
 
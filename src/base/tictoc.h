@@ -31,6 +31,9 @@ namespace TicToc
     
     /// number of micro-second since midnight
     long    milli_seconds_today();
+    
+    /// wall-time in milli-seconds, with micro-second resolution (thread-safe)
+    double  milli_seconds();
  
     
     /// CPU time in short format, `buf` must be   
@@ -153,6 +153,20 @@ extern "C" {
     }
     
     
+    void FORTRAN(gbtrf)(int*, int*, int*, int*, real*, int*, int*, int*);
+    inline void lapack_xgbtrf(int M, int N, int KL, int KU, real* AB, int LDAB, int* IPIV, int* INFO)
+    {
+        FORTRAN(gbtrf)(&M, &N, &KL, &KU, AB, &LDAB, IPIV, INFO);
+    }
+
+
+    void FORTRAN(gbtrs)(char *, int*, int*, int*, int*, const real*, int*, const int*, real*, int*, int*);
+    inline void lapack_xgbtrs(char trans, int N, int KL, int KU, int NRHS, const real* AB, int LDAB, const int* IPIV, real* B, int LDB, int* INFO)
+    {
+        FORTRAN(gbtrs)(&trans, &N, &KL, &KU, &NRHS, AB, &LDAB, IPIV, B, &LDB, INFO);
+    }
+
+
     void FORTRAN(laswp)(int*, const real*, int*, int*, int*, const int*, int*);
     inline void lapack_xlaswp(int N, const real* A, int LDA, int K1, int K2, const int* IPIV, int INCX)
     {
@@ -222,6 +222,8 @@ public:
         gCell       = 0;
         regionsEdge = 0;
         regions     = 0;
+        regionSize  = 0;
+        regionsByCell = true;
         cVolume     = 0;
 #ifndef NO_PERIODIC_SUPPORT
         imageI      = imageIB;
@@ -441,6 +443,24 @@ public:
     }
         
     
+    /// index of cell of coordinates (x) for ORD==1
+    INDEX index1D(const int x) const
+    {
+        return imageI(gDim[0], x);
+    }
+    
+    /// index of cell of coordinates (x, y) for ORD==2
+    INDEX index2D(const int x, const int y) const
+    {
+        return imageI(gDim[0], x) + gDim[0]*imageI(gDim[1], y);
+    }
+    
+    /// index of cell of coordinates (x, y, z) for ORD==3
+    INDEX index3D(const int x, const int y, const int z) const
+    {
+        return imageI(gDim[0], x) + gDim[0]*( imageI(gDim[1], y) + gDim[1]*imageI(gDim[2], z) );
+    }
+    
     /// returns the index of the cell whose center is closest to the point w[]
     INDEX index(const real w[ORD], const real offset=0) const
     {
@@ -523,6 +543,14 @@ public:
         return gCell;
     }
     
+    /// address of cell at index 'indx', or zero if this cell was not allocated
+    CELL * find(const INDEX indx) const
+    {
+        assert_true( gCell );
+        assert_true( indx < nCells );
+        return gCell + indx;
+    }
+    
     /// return cell at index 'indx'
     CELL & cell(const INDEX indx) const
     {
@@ -586,7 +614,7 @@ public:
     CELL & cell1D(const int x) const
     {
         assert_true( ORD == 1  &&  gCell );
-        INDEX inx = imageI(gDim[0], x);
+        INDEX inx = index1D(x);
         assert_true( inx < nCells );
         return gCell[ inx ];
     }
@@ -595,7 +623,7 @@ public:
     CELL & cell2D(const int x, const int y) const
     {
         assert_true( ORD == 2  &&  gCell );
-        INDEX inx = imageI(gDim[0], x) + gDim[0]*imageI(gDim[1], y);
+        INDEX inx = index2D(x, y);
         assert_true( inx < nCells );
         return gCell[ inx ];
     }
@@ -604,7 +632,7 @@ public:
     CELL & cell3D(const int x, const int y, const int z) const
     {
         assert_true( ORD == 3  &&  gCell );
-        INDEX inx = imageI(gDim[0], x) + gDim[0]*( imageI(gDim[1], y) + gDim[1]*imageI(gDim[2], z) );
+        INDEX inx = index3D(x, y, z);
         assert_true( inx < nCells );
         return gCell[ inx ];
     }
@@ -625,6 +653,17 @@ private:
     /// pointers to regionsEdge[], as a function of cell index
     int ** regions;
     
+    /// range used to calculate the edge-characteristic of a cell
+    int    regionRange[ORD];
+    
+    /// size of the entry of each edge-characteristic in regionsEdge[]
+    int    regionSize;
+    
+protected:
+    
+    /// if false, regions[] is not allocated, and getRegion() derives the region from the coordinates of the cell
+    bool   regionsByCell;
+    
 private:
     
     /// calculate the edge-characteristic from the size \a s, coordinate \a c and range \a r
@@ -734,12 +773,42 @@ private:
         //allocate and reset arrays:
         deleteRegions();
         
-        regions     = new int*[nCells];
         regionsEdge = new int[edgeMax*(regMax+1)];
         for ( INDEX e = 0; e < edgeMax*(regMax+1); ++e )
             regionsEdge[e] = 0;
         
+        regionSize = regMax + 1;
+        for ( int d = 0; d < ORD; ++d )
+            regionRange[d] = range[d];
+        
         int ori[ORD];
+        
+        if ( !regionsByCell )
+        {
+            // visit one cell of each edge-characteristic, skipping the interior ones:
+            for ( int d = 0; d < ORD; ++d )
+                ori[d] = 0;
+            int d = 0;
+            while ( d < ORD )
+            {
+                int * reg = regionsEdge + edgeFromCoordinates(ori, range) * regionSize;
+                if ( reg[0] == 0 )
+                    reg[0] = calculateOffsets(reg+1, ccc, regMax, ori, positive);
+                
+                for ( d = 0; d < ORD; ++d )
+                {
+                    ++ori[d];
+                    if ( ori[d] == range[d] + 1  &&  ori[d] < (int)gDim[d] - range[d] )
+                        ori[d] = gDim[d] - range[d];
+                    if ( ori[d] < (int)gDim[d] )
+                        break;
+                    ori[d] = 0;
+                }
+            }
+            return;
+        }
+        
+        regions = new int*[nCells];
         for ( INDEX indx = 0; indx < nCells; ++indx )
         {
             setCoordinatesFromIndex(ori, indx);
@@ -863,7 +932,7 @@ public:
     /// true is createRegions() or createRoundRegions() was called
     bool hasRegions() const
     {
-        return ( regions != 0  &&  regionsEdge != 0 );
+        return ( regionsEdge != 0 )  &&  ( regions != 0  ||  !regionsByCell );
     }
     
     /// set region array 'offsets' for cell index
@@ -887,9 +956,18 @@ public:
     int getRegion(int*& offsets, const INDEX indx) const
     {
         assert_true( hasRegions() );
-        offsets = regions[indx]+1;
+        int * reg;
+        if ( regions )
+            reg = regions[indx];
+        else
+        {
+            int ori[ORD];
+            setCoordinatesFromIndex(ori, indx);
+            reg = regionsEdge + edgeFromCoordinates(ori, regionRange) * regionSize;
+        }
+        offsets = reg+1;
         assert_true( offsets[0] == 0 );
-        return regions[indx][0];
+        return reg[0];
     }
     
     /// free memory occupied by the regions
@@ -0,0 +1,243 @@
+// Cytosim was created by Francois Nedelec. Copyright 2007-2017 EMBL.
+
+#ifndef GRID_SPARSE_H
+#define GRID_SPARSE_H
+
+#include "grid.h"
+#include <algorithm>
+
+
+///Divide a rectangle of dimensionality ORD into regular voxels, allocating only the cells that are used
+/**
+ GridSparse<int ORD, typename CELL, typename INDEX> has the same geometry and indices as Grid,
+ but the cells are not allocated by createCells(). They are instead allocated
+ by rows of nbCells(0) consecutive cells along the first dimension (X),
+ when one of the cells of the row is accessed for the first time.
+ This is suitable for a fine grid covering a large region, in which only
+ a small fraction of the cells are occupied.
+
+ Since cells with consecutive X-coordinates belong to the same row, they are
+ consecutive in memory, as in Grid:
+ @code
+ CELL * inf = &grid.cell2D(x_inf, y);
+ CELL * sup = &grid.cell2D(x_sup, y);
+ for ( CELL * c = inf; c <= sup; ++c )
+     ...
+ @endcode
+
+ All the functions that return a reference to a CELL allocate its row if necessary,
+ and thus should not be called concurrently by different threads.
+ find() can be used to access a cell without allocating it,
+ and clear() only visits the rows that have been allocated.
+ The cells remain allocated until deleteCells() is called.
+
+ The regions, used to find neighboring cells, are inherited from Grid,
+ but they are not stored for each cell: getRegion() derives the region of a cell
+ from its coordinates. The memory used is thus proportional to the number of
+ allocated rows, and not to the total number of cells.
+ */
+template <int ORD, typename CELL, typename INDEX>
+class GridSparse : public Grid<ORD, CELL, INDEX>
+{
+    typedef Grid<ORD, CELL, INDEX> Base;
+
+    /// Disabled copy constructor
+    GridSparse<ORD, CELL, INDEX>(GridSparse<ORD, CELL, INDEX> const&);
+
+    /// Disabled copy assignment
+    GridSparse<ORD, CELL, INDEX>& operator=(GridSparse<ORD, CELL, INDEX> const&);
+
+    /// array of rows, with gRow[r] = 0 if row 'r' is not allocated
+    CELL ** gRow;
+
+    /// number of rows = nbCells() / nbCells(0)
+    INDEX   nRows;
+
+    /// indices of the rows that have been allocated
+    INDEX * gUsed;
+
+    /// number of rows allocated
+    mutable INDEX nUsed;
+
+    /// number of rows of gUsed[] that are known to be in increasing order
+    INDEX   nSorted;
+
+    /// return row 'r', allocating it if necessary
+    CELL * row(const INDEX r) const
+    {
+        assert_true( gRow );
+        assert_true( r < nRows );
+        CELL *& res = gRow[r];
+        if ( !res )
+        {
+            res = new CELL[Base::gDim[0]];
+            gUsed[nUsed++] = r;
+        }
+        return res;
+    }
+
+public:
+
+    /// constructor
+    GridSparse()
+    {
+        gRow  = 0;
+        nRows = 0;
+        gUsed = 0;
+        nUsed = 0;
+        nSorted = 0;
+        Base::regionsByCell = false;
+    }
+
+    /// Destructor
+    virtual ~GridSparse() { deleteCells(); }
+
+    //--------------------------------------------------------------------------
+#pragma mark -
+#pragma mark Cells
+
+    /// allocate the array of rows, but not the cells
+    void createCells()
+    {
+        if ( Base::nCells == 0 )
+            printf("nCells==0 in createCells() : call setDimensions() first\n");
+
+        deleteCells();
+
+        nRows = Base::nCells / Base::gDim[0];
+        gRow  = new CELL*[nRows];
+        gUsed = new INDEX[nRows];
+        for ( INDEX r = 0; r < nRows; ++r )
+            gRow[r] = 0;
+        nUsed = 0;
+        nSorted = 0;
+    }
+
+    /// returns true if createCells() was called
+    bool hasCells() const
+    {
+        return ( gRow != 0 );
+    }
+
+    /// deallocate all the cells
+    void deleteCells()
+    {
+        for ( INDEX u = 0; u < nUsed; ++u )
+            delete[] gRow[gUsed[u]];
+        delete[] gRow;
+        delete[] gUsed;
+        gRow  = 0;
+        gUsed = 0;
+        nRows = 0;
+        nUsed = 0;
+        nSorted = 0;
+    }
+
+    /// call function clear() for all the cells that have been allocated
+    void clear()
+    {
+        const INDEX nx = Base::gDim[0];
+        for ( INDEX u = 0; u < nUsed; ++u )
+        {
+            CELL * c = gRow[gUsed[u]];
+            for ( INDEX x = 0; x < nx; ++x )
+                c[x].clear();
+        }
+    }
+
+    /// number of cells that have been allocated
+    INDEX nbAllocatedCells() const
+    {
+        return nUsed * Base::gDim[0];
+    }
+
+    /// set `rows` to the indices of the allocated rows in increasing order, and return their number
+    /**
+     Row `r` contains the cells of indices [ r*nbCells(0), (r+1)*nbCells(0) [.
+     Visiting these cells in order is equivalent to visiting all the cells of a Grid,
+     skipping the ones that were never allocated.
+     */
+    INDEX sortedRows(INDEX const*& rows)
+    {
+        if ( nSorted < nUsed )
+        {
+            std::sort(gUsed, gUsed+nUsed);
+            nSorted = nUsed;
+        }
+        rows = gUsed;
+        return nUsed;
+    }
+
+    //--------------------------------------------------------------------------
+
+    /// address of cell at index 'indx', or zero if this cell was not allocated
+    CELL * find(const INDEX indx) const
+    {
+        assert_true( indx < Base::nCells );
+        CELL * r = gRow[ indx / Base::gDim[0] ];
+        if ( r )
+            return r + indx % Base::gDim[0];
+        return 0;
+    }
+
+    /// return cell at index 'indx'
+    CELL & cell(const INDEX indx) const
+    {
+        assert_true( indx < Base::nCells );
+        return row( indx / Base::gDim[0] )[ indx % Base::gDim[0] ];
+    }
+
+    /// reference to CELL whose center is closest to w[]
+    CELL & cell(const real w[ORD]) const
+    {
+        return cell( Base::index(w) );
+    }
+
+    /// reference to CELL of coordinates c[]
+    CELL & cell(const int c[ORD]) const
+    {
+        return cell( Base::indexFromCoordinates(c) );
+    }
+
+    /// operator access to a cell by index
+    CELL & operator[](const INDEX indx) const
+    {
+        return cell(indx);
+    }
+
+    /// operator access to a cell by position
+    CELL & operator()(const real w[ORD]) const
+    {
+        return cell( Base::index(w) );
+    }
+
+    /// short-hand access to a cell by co-oordinates
+    CELL & operator()(const int c[ORD]) const
+    {
+        return cell( Base::indexFromCoordinates(c) );
+    }
+
+    /// access to cell for ORD==1
+    CELL & cell1D(const int x) const
+    {
+        assert_true( ORD == 1 );
+        return cell( Base::index1D(x) );
+    }
+
+    /// access to cell for ORD==2
+    CELL & cell2D(const int x, const int y) const
+    {
+        assert_true( ORD == 2 );
+        return cell( Base::index2D(x, y) );
+    }
+
+    /// access to cell for ORD==3
+    CELL & cell3D(const int x, const int y, const int z) const
+    {
+        assert_true( ORD == 3 );
+        return cell( Base::index3D(x, y, z) );
+    }
+};
+
+
+#endif
@@ -105,6 +105,39 @@ void Matrix::printFull(std::ostream & os) const
     }
 }
 
+//------------------------------------------------------------------------------
+Matrix::index_type Matrix::findRoot(index_type* parent, index_type i)
+{
+    while ( parent[i] != i )
+    {
+        // path halving:
+        parent[i] = parent[parent[i]];
+        i = parent[i];
+    }
+    return i;
+}
+
+
+void Matrix::joinRoots(index_type* parent, index_type i, index_type j)
+{
+    i = findRoot(parent, i);
+    j = findRoot(parent, j);
+    if ( i < j )
+        parent[j] = i;
+    else if ( j < i )
+        parent[i] = j;
+}
+
+
+void Matrix::joinLines(index_type* parent, const unsigned int div) const
+{
+    const unsigned int sz = size();
+    for ( unsigned int ii = 0; ii < sz; ++ii )
+        for ( unsigned int jj = 0; jj < ii; ++jj )
+            if ( addr( ii, jj ) )
+                joinRoots(parent, ii / div, jj / div);
+}
+
 //------------------------------------------------------------------------------
 void Matrix::printSparse(std::ostream & os) const
 {
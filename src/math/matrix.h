@@ -97,6 +97,15 @@ public:
     /// returns a string which a description of the type of matrix
     virtual std::string what() const = 0;
     
+    /// join the lines ( i / div ) and ( j / div ) for any allocated element (i, j), in the union-find forest `parent`
+    virtual void joinLines(index_type* parent, unsigned int div) const;
+    
+    /// return the root of `i` in the union-find forest `parent`
+    static index_type findRoot(index_type* parent, index_type i);
+    
+    /// merge the trees containing `i` and `j`, using the smallest index as root
+    static void joinRoots(index_type* parent, index_type i, index_type j);
+    
     /// printf debug function in sparse mode: i, j : value
     virtual void printSparse(std::ostream &) const;
     
@@ -27,6 +27,8 @@ MatrixSparseSymmetric1::MatrixSparseSymmetric1()
     nmax    = 0;
     ija     = 0;
     sa      = 0;
+    ijt     = 0;
+    sat     = 0;
 #endif
 }
 
@@ -90,6 +92,16 @@ void MatrixSparseSymmetric1::deallocate()
         delete[] colF;      colF = 0;
 #endif
     }
+#ifdef MATRIX_OPTIMIZE_MULTIPLY
+    if ( ija )
+    {
+        delete[] ija;       ija = 0;
+        delete[] sa;        sa  = 0;
+        delete[] ijt;       ijt = 0;
+        delete[] sat;       sat = 0;
+        nmax = 0;
+    }
+#endif
     mxAllocated = 0;
 }
 
@@ -310,6 +322,30 @@ void MatrixSparseSymmetric1::addDiagonalBlock(real* M, const index_type x, const
 }
 
 
+/**
+ M should be of size (kd+1)*sx, and uses the LAPACK symmetric band storage:
+ element (i, j) with i <= j is stored in M[kd+i-j+(kd+1)*j]
+ */
+void MatrixSparseSymmetric1::addDiagonalBand(real* M, const index_type x, const unsigned int sx, const unsigned int kd ) const
+{
+    assert_true( x + sx <= mxSize );
+    
+    for ( index_type jj = 0; jj < sx; ++jj )
+    {
+        for ( unsigned int kk = 0 ; kk < colSize[jj+x] ; ++kk )
+        {
+            index_type ii = col[jj+x][kk].line;
+            if ( x <= ii )
+            {
+                ii -= x;
+                if ( ii < sx  &&  ii <= jj + kd )
+                    M[kd+jj-ii+(kd+1)*ii] += col[jj+x][kk].val;
+            }
+        }
+    }
+}
+
+
 //------------------------------------------------------------------------------
 int MatrixSparseSymmetric1::bad() const
 {
@@ -362,6 +398,17 @@ unsigned int MatrixSparseSymmetric1::nbNonZeroElements() const
 }
 
 
+/**
+ All the allocated elements are considered, even if they are zero
+ */
+void MatrixSparseSymmetric1::joinLines(index_type* parent, const unsigned int div) const
+{
+    for ( index_type jj = 0; jj < mxSize; ++jj )
+        for ( unsigned int kk = 1; kk < colSize[jj]; ++kk )
+            joinRoots(parent, col[jj][kk].line / div, jj / div);
+}
+
+
 std::string MatrixSparseSymmetric1::what() const
 {
     std::ostringstream msg;
@@ -382,7 +429,7 @@ void MatrixSparseSymmetric1::prepareForMultiply()
 }
 
 
-void MatrixSparseSymmetric1::vecMulAdd( const real* X, real* Y ) const
+void MatrixSparseSymmetric1::vecMulAdd( const real* X, real* Y, const index_type start, const index_type stop ) const
 {
     for ( index_type jj = 0; jj < mxSize; ++jj )
     {
@@ -390,25 +437,30 @@ void MatrixSparseSymmetric1::vecMulAdd( const real* X, real* Y ) const
         {
             const index_type ii = col[jj][kk].line;
             const real a = col[jj][kk].val;
-            Y[ii] += a * X[jj];
-            if ( ii != jj )
+            if ( start <= ii  &&  ii < stop )
+                Y[ii] += a * X[jj];
+            if ( ii != jj  &&  start <= jj  &&  jj < stop )
                 Y[jj] += a * X[ii];
         }
     }
 }
 
 
-void MatrixSparseSymmetric1::vecMulAddIso2D( const real* X, real* Y ) const
+void MatrixSparseSymmetric1::vecMulAddIso2D( const real* X, real* Y, const index_type start, const index_type stop ) const
 {
     for ( index_type jj = 0, Djj=0; jj < mxSize; ++jj, Djj+=2 )
     {
         for ( unsigned int kk = 0 ; kk < colSize[jj] ; ++kk )
         {
-            const index_type Dii = 2 * col[jj][kk].line;
+            const index_type ii = col[jj][kk].line;
+            const index_type Dii = 2 * ii;
             const real  a = col[jj][kk].val;
-            Y[Dii  ] += a * X[Djj  ];
-            Y[Dii+1] += a * X[Djj+1];
-            if ( Dii != Djj )
+            if ( start <= ii  &&  ii < stop )
+            {
+                Y[Dii  ] += a * X[Djj  ];
+                Y[Dii+1] += a * X[Djj+1];
+            }
+            if ( Dii != Djj  &&  start <= jj  &&  jj < stop )
             {
                 Y[Djj  ] += a * X[Dii  ];
                 Y[Djj+1] += a * X[Dii+1];
@@ -418,18 +470,22 @@ void MatrixSparseSymmetric1::vecMulAddIso2D( const real* X, real* Y ) const
 }
 
 
-void MatrixSparseSymmetric1::vecMulAddIso3D( const real* X, real* Y ) const
+void MatrixSparseSymmetric1::vecMulAddIso3D( const real* X, real* Y, const index_type start, const index_type stop ) const
 {
     for ( index_type jj = 0, Djj=0; jj < mxSize; ++jj, Djj+=3 )
     {
         for ( unsigned int kk = 0 ; kk < colSize[jj] ; ++kk )
         {
-            const index_type Dii = 3 * col[jj][kk].line;
+            const index_type ii = col[jj][kk].line;
+            const index_type Dii = 3 * ii;
             const real  a =     col[jj][kk].val;
-            Y[Dii  ] += a * X[Djj  ];
-            Y[Dii+1] += a * X[Djj+1];
-            Y[Dii+2] += a * X[Djj+2];
-            if ( Dii != Djj )
+            if ( start <= ii  &&  ii < stop )
+            {
+                Y[Dii  ] += a * X[Djj  ];
+                Y[Dii+1] += a * X[Djj+1];
+                Y[Dii+2] += a * X[Djj+2];
+            }
+            if ( Dii != Djj  &&  start <= jj  &&  jj < stop )
             {
                 Y[Djj  ] += a * X[Dii  ];
                 Y[Djj+1] += a * X[Dii+1];
@@ -488,10 +544,14 @@ void MatrixSparseSymmetric1::prepareForMultiply()
     {
         if ( ija )  delete[] ija;
         if ( sa )   delete[] sa;
+        if ( ijt )  delete[] ijt;
+        if ( sat )  delete[] sat;
         
         nmax  = nbe + mxSize;
         ija   = new index_type[nmax];
         sa    = new real[nmax];
+        ijt   = new index_type[nmax];
+        sat   = new real[nmax];
     }
     
     //create the sparse representation, described in numerical-recipe
@@ -520,22 +580,66 @@ void MatrixSparseSymmetric1::prepareForMultiply()
         ija[jj+1] = kk+1;
     }
     assert_true( kk+1 == nbe );
+    
+    /*
+     Store the off-diagonal elements by lines, in the same format.
+     Since the columns are scanned in increasing order,
+     the elements of each line are sorted by increasing column.
+     */
+    for ( index_type ii = 0; ii <= mxSize; ++ii )
+        ijt[ii] = 0;
+    for ( index_type jj = 0; jj < mxSize; ++jj )
+        for ( unsigned int cc = 1; cc < colSize[jj]; ++cc )
+            ++ijt[col[jj][cc].line];
+    
+    // convert counts to offsets:
+    kk = mxSize + 1;
+    for ( index_type ii = 0; ii <= mxSize; ++ii )
+    {
+        index_type n = ijt[ii];
+        ijt[ii] = kk;
+        kk += n;
+    }
+    
+    // fill, using ijt[ii] as a cursor for line ii:
+    for ( index_type jj = 0; jj < mxSize; ++jj )
+    {
+        for ( unsigned int cc = 1; cc < colSize[jj]; ++cc )
+        {
+            index_type n = ijt[col[jj][cc].line]++;
+            ijt[n] = jj;
+            sat[n] = col[jj][cc].val;
+        }
+    }
+    
+    // the cursors are now at the start of the next line:
+    for ( index_type ii = mxSize; ii > 0; --ii )
+        ijt[ii] = ijt[ii-1];
+    ijt[0] = mxSize + 1;
 }
 
 
-void MatrixSparseSymmetric1::vecMulAdd( const real* X, real* Y ) const
+/**
+ Each line is calculated independently, adding the elements in the order:
+ - elements of the line below the diagonal, by increasing column,
+ - diagonal element,
+ - elements of the column below the diagonal.
+ .
+ */
+void MatrixSparseSymmetric1::vecMulAdd( const real* X, real* Y, const index_type start, const index_type stop ) const
 {
-    for ( index_type jj = colF[0]; jj < mxSize; jj = colF[jj+1] )
+    assert_true( stop <= mxSize );
+    for ( index_type jj = start; jj < stop; ++jj )
     {
-        real X0 = X[jj];
-        real Y0 = Y[jj] + sa[jj] * X0;
-        const index_type end = ija[jj+1];
-        for ( index_type kk = ija[jj]; kk < end; ++kk )
+        real Y0 = Y[jj];
+        for ( index_type kk = ijt[jj]; kk < ijt[jj+1]; ++kk )
+            Y0 += sat[kk] * X[ijt[kk]];
+        if ( colSize[jj] > 0 )
         {
-            real a = sa[kk];
-            index_type ii = ija[kk];
-            Y[ii] += a * X0;
-            Y0    += a * X[ii];
+            Y0 += sa[jj] * X[jj];
+            const index_type end = ija[jj+1];
+            for ( index_type kk = ija[jj]; kk < end; ++kk )
+                Y0 += sa[kk] * X[ija[kk]];
         }
         Y[jj] = Y0;
     }
@@ -550,21 +654,28 @@ void MatrixSparseSymmetric1::vecMulAdd( const real* X, real* Y ) const
 
 #define SSE(x) _mm_##x##_pd
 
-void MatrixSparseSymmetric1::vecMulAddIso2D( const real* X, real* Y ) const
+void MatrixSparseSymmetric1::vecMulAddIso2D( const real* X, real* Y, const index_type start, const index_type stop ) const
 {
-    for ( index_type jj = colF[0]; jj < mxSize; jj = colF[jj+1] )
+    assert_true( stop <= mxSize );
+    for ( index_type jj = start; jj < stop; ++jj )
     {
-        __m128d x, y, a, t;
-        x = SSE(load)(X+2*jj);
-        a = SSE(loaddup)(sa+jj);
-        y = SSE(add)(_mm_load_pd(Y+2*jj), SSE(mul)(a, x));
-        const index_type end = ija[jj+1];
-        for ( index_type kk = ija[jj]; kk < end; ++kk )
+        __m128d y, a;
+        y = SSE(load)(Y+2*jj);
+        for ( index_type kk = ijt[jj]; kk < ijt[jj+1]; ++kk )
+        {
+            a = SSE(loaddup)(sat+kk);
+            y = SSE(add)(y, SSE(mul)(SSE(load)(X+2*ijt[kk]), a));
+        }
+        if ( colSize[jj] > 0 )
         {
-            a = SSE(loaddup)(sa+kk);
-            t = SSE(add)(SSE(load)(Y+2*ija[kk]), SSE(mul)(x, a));
-            y = SSE(add)(y, SSE(mul)(SSE(load)(X+2*ija[kk]), a));
-            SSE(store)(Y+2*ija[kk], t);
+            a = SSE(loaddup)(sa+jj);
+            y = SSE(add)(y, SSE(mul)(a, SSE(load)(X+2*jj)));
+            const index_type end = ija[jj+1];
+            for ( index_type kk = ija[jj]; kk < end; ++kk )
+            {
+                a = SSE(loaddup)(sa+kk);
+                y = SSE(add)(y, SSE(mul)(SSE(load)(X+2*ija[kk]), a));
+            }
         }
         SSE(store)(Y+2*jj, y);
     }
@@ -572,25 +683,34 @@ void MatrixSparseSymmetric1::vecMulAddIso2D( const real* X, real* Y ) const
 
 #else
 
-void MatrixSparseSymmetric1::vecMulAddIso2D( const real* X, real* Y ) const
-{    
-    for ( index_type jj = colF[0]; jj < mxSize; jj = colF[jj+1] )
+void MatrixSparseSymmetric1::vecMulAddIso2D( const real* X, real* Y, const index_type start, const index_type stop ) const
+{
+    assert_true( stop <= mxSize );
+    for ( index_type jj = start; jj < stop; ++jj )
     {
         index_type Djj = 2 * jj;
-        real X0 = X[Djj  ];
-        real X1 = X[Djj+1];
-        real Y0 = Y[Djj  ] + sa[jj] * X0;
-        real Y1 = Y[Djj+1] + sa[jj] * X1;
-        const index_type end = ija[jj+1];
-        for ( index_type kk = ija[jj]; kk < end; ++kk )
+        real Y0 = Y[Djj  ];
+        real Y1 = Y[Djj+1];
+        for ( index_type kk = ijt[jj]; kk < ijt[jj+1]; ++kk )
         {
-            index_type Dii = 2 * ija[kk];
-            assert_true( Djj != Dii );
-            real a = sa[kk];
-            Y0       += a * X[Dii  ];
-            Y1       += a * X[Dii+1];
-            Y[Dii  ] += a * X0;
-            Y[Dii+1] += a * X1;
+            index_type Dii = 2 * ijt[kk];
+            real a = sat[kk];
+            Y0 += a * X[Dii  ];
+            Y1 += a * X[Dii+1];
+        }
+        if ( colSize[jj] > 0 )
+        {
+            Y0 += sa[jj] * X[Djj  ];
+            Y1 += sa[jj] * X[Djj+1];
+            const index_type end = ija[jj+1];
+            for ( index_type kk = ija[jj]; kk < end; ++kk )
+            {
+                index_type Dii = 2 * ija[kk];
+                assert_true( Djj != Dii );
+                real a = sa[kk];
+                Y0 += a * X[Dii  ];
+                Y1 += a * X[Dii+1];
+            }
         }
         Y[Djj  ] = Y0;
         Y[Djj+1] = Y1;
@@ -600,29 +720,38 @@ void MatrixSparseSymmetric1::vecMulAddIso2D( const real* X, real* Y ) const
 #endif
 
 
-void MatrixSparseSymmetric1::vecMulAddIso3D( const real* X, real* Y ) const
+void MatrixSparseSymmetric1::vecMulAddIso3D( const real* X, real* Y, const index_type start, const index_type stop ) const
 {
-    for ( index_type jj = colF[0]; jj < mxSize; jj = colF[jj+1] )
+    assert_true( stop <= mxSize );
+    for ( index_type jj = start; jj < stop; ++jj )
     {
         index_type Djj = 3 * jj;
-        real X0 = X[Djj  ];
-        real X1 = X[Djj+1];
-        real X2 = X[Djj+2];
-        real Y0 = Y[Djj  ] + sa[jj] * X0;
-        real Y1 = Y[Djj+1] + sa[jj] * X1;
-        real Y2 = Y[Djj+2] + sa[jj] * X2;
-        const index_type next = ija[jj+1];
-        for ( index_type kk = ija[jj]; kk < next; ++kk )
+        real Y0 = Y[Djj  ];
+        real Y1 = Y[Djj+1];
+        real Y2 = Y[Djj+2];
+        for ( index_type kk = ijt[jj]; kk < ijt[jj+1]; ++kk )
         {
-            index_type Dii = 3 * ija[kk];
-            assert_true( Djj != Dii );
-            real a = sa[kk];
-            Y0       += a * X[Dii  ];
-            Y1       += a * X[Dii+1];
-            Y2       += a * X[Dii+2];
-            Y[Dii  ] += a * X0;
-            Y[Dii+1] += a * X1;
-            Y[Dii+2] += a * X2;
+            index_type Dii = 3 * ijt[kk];
+            real a = sat[kk];
+            Y0 += a * X[Dii  ];
+            Y1 += a * X[Dii+1];
+            Y2 += a * X[Dii+2];
+        }
+        if ( colSize[jj] > 0 )
+        {
+            Y0 += sa[jj] * X[Djj  ];
+            Y1 += sa[jj] * X[Djj+1];
+            Y2 += sa[jj] * X[Djj+2];
+            const index_type next = ija[jj+1];
+            for ( index_type kk = ija[jj]; kk < next; ++kk )
+            {
+                index_type Dii = 3 * ija[kk];
+                assert_true( Djj != Dii );
+                real a = sa[kk];
+                Y0 += a * X[Dii  ];
+                Y1 += a * X[Dii+1];
+                Y2 += a * X[Dii+2];
+            }
         }
         Y[Djj  ] = Y0;
         Y[Djj+1] = Y1;
@@ -13,6 +13,11 @@
  MatrixSparseSymmetric1 uses a sparse storage, with arrays of elements for each column.
  For multiplication, it uses a another format, from Numerical Recipes.
  The conversion is done when prepareForMultiply() is called
+ 
+ The lower triangle is also stored by lines, such that any range of lines of
+ the product by a vector can be calculated independently, for example by different
+ threads. The operations are done in the same order for any range, and the result
+ does not depend on how the lines are distributed.
 */
 class MatrixSparseSymmetric1 : public Matrix
 {
@@ -57,6 +62,10 @@ private:
     index_type  * ija;
     real        * sa;
     
+    ///the off-diagonal elements stored by lines, in the format of ija and sa
+    index_type  * ijt;
+    real        * sat;
+    
     /// update colF[]
     void setColF(bool);    
 #endif
@@ -96,17 +105,29 @@ public:
     /// add the upper triagular block ( x, x, x+sx, x+sx ) from this matrix to M
     void addTriangularBlock( real* M, index_type x, unsigned int sx) const;
     
+    /// add the elements of the block ( x, x, x+sx, x+sx ) that are within `kd` of the diagonal to M, in symmetric band storage
+    void addDiagonalBand( real* M, index_type x, unsigned int sx, unsigned int kd) const;
+    
     ///optional optimization that may accelerate multiplications by a vector
     void prepareForMultiply();
     
     /// multiplication of a vector: Y = Y + M * X, dim(X) = dim(M)
-    void vecMulAdd( const real* X, real* Y ) const;
+    void vecMulAdd( const real* X, real* Y ) const { vecMulAdd(X, Y, 0, mxSize); }
     
     /// 2D isotropic multiplication of a vector: Y = Y + M * X
-    void vecMulAddIso2D( const real* X, real* Y ) const;
+    void vecMulAddIso2D( const real* X, real* Y ) const { vecMulAddIso2D(X, Y, 0, mxSize); }
     
     /// 3D isotropic multiplication of a vector: Y = Y + M * X
-    void vecMulAddIso3D( const real* X, real* Y ) const;
+    void vecMulAddIso3D( const real* X, real* Y ) const { vecMulAddIso3D(X, Y, 0, mxSize); }
+    
+    /// calculate the lines [start, stop[ of Y = Y + M * X
+    void vecMulAdd( const real* X, real* Y, index_type start, index_type stop ) const;
+    
+    /// calculate the lines [start, stop[ of the 2D isotropic multiplication Y = Y + M * X
+    void vecMulAddIso2D( const real* X, real* Y, index_type start, index_type stop ) const;
+    
+    /// calculate the lines [start, stop[ of the 3D isotropic multiplication Y = Y + M * X
+    void vecMulAddIso3D( const real* X, real* Y, index_type start, index_type stop ) const;
     
     /// true if matrix is non-zero
     bool nonZero() const;
@@ -114,6 +135,9 @@ public:
     /// number of element which are non-zero
     unsigned int  nbNonZeroElements() const;
     
+    /// join the lines connected by an element, in the union-find forest `parent`
+    void joinLines(index_type* parent, unsigned int div) const;
+    
     /// returns a string which a description of the type of matrix
     std::string what() const;
     
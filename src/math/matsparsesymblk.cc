@@ -0,0 +1,602 @@
+// Cytosim was created by Francois Nedelec. Copyright 2007-2017 EMBL.
+
+#include "matsparsesymblk.h"
+#include "cblas.h"
+#include "smath.h"
+
+#include <iomanip>
+#include <sstream>
+
+#define MATRIX_USES_INTEL_SSE3 ( DIM == 2 ) && defined(__SSE3__) && !defined(REAL_IS_FLOAT)
+
+
+//------------------------------------------------------------------------------
+
+
+MatrixSparseSymmetricBlock::MatrixSparseSymmetricBlock()
+{
+    mxSize      = 0;
+    mxBlocks    = 0;
+    mxAllocated = 0;
+
+    col      = 0;
+    colSize  = 0;
+    colMax   = 0;
+    lnkStart = 0;
+    lnk      = 0;
+    lnkMax   = 0;
+}
+
+
+void MatrixSparseSymmetricBlock::allocate( const unsigned int sz )
+{
+    assert_true( sz % DIM == 0 );
+    mxSize   = sz;
+    mxBlocks = sz / DIM;
+    if ( mxBlocks > mxAllocated )
+    {
+        Block ** col_new          = new Block*[mxBlocks];
+        unsigned int * colSize_new = new unsigned int[mxBlocks];
+        unsigned int * colMax_new  = new unsigned int[mxBlocks];
+
+        unsigned int ii = 0;
+        if ( col )
+        {
+            for ( ; ii < mxAllocated; ++ii )
+            {
+                col_new[ii]     = col[ii];
+                colSize_new[ii] = colSize[ii];
+                colMax_new[ii]  = colMax[ii];
+            }
+            delete[] col;
+            delete[] colSize;
+            delete[] colMax;
+            delete[] lnkStart;
+        }
+
+        for ( ; ii < mxBlocks; ++ii )
+        {
+            col_new[ii]     = 0;
+            colSize_new[ii] = 0;
+            colMax_new[ii]  = 0;
+        }
+
+        col       = col_new;
+        colSize   = colSize_new;
+        colMax    = colMax_new;
+        lnkStart  = new unsigned int[mxBlocks+1];
+        mxAllocated = mxBlocks;
+    }
+}
+
+
+void MatrixSparseSymmetricBlock::deallocate()
+{
+    if ( col )
+    {
+        for ( unsigned int ii = 0; ii < mxAllocated; ++ii )
+        {
+            if ( col[ii] )
+                delete[] col[ii];
+        }
+        delete[] col;       col      = 0;
+        delete[] colSize;   colSize  = 0;
+        delete[] colMax;    colMax   = 0;
+        delete[] lnkStart;  lnkStart = 0;
+    }
+    if ( lnk )
+    {
+        delete[] lnk;
+        lnk = 0;
+    }
+    lnkMax = 0;
+    mxAllocated = 0;
+}
+
+
+MatrixSparseSymmetricBlock::Block * MatrixSparseSymmetricBlock::allocateColumn( const index_type jj, unsigned int sz )
+{
+    assert_true( jj < mxBlocks );
+    assert_true( sz > 0 );
+
+    if ( sz > colMax[jj] )
+    {
+        const unsigned chunk = 4;
+        sz = ( sz + chunk - 1 ) & -chunk;
+        Block * col_new = new Block[sz];
+
+        if ( col[jj] )
+        {
+            //copy what is there
+            for ( unsigned int ii = 0; ii < colSize[jj]; ++ii )
+                col_new[ii] = col[jj][ii];
+
+            //release old memory
+            delete[] col[jj];
+        }
+        col[jj]    = col_new;
+        colMax[jj] = sz;
+        return col_new;
+    }
+    return col[jj];
+}
+
+
+inline void clearBlock(real* val)
+{
+    for ( unsigned int k = 0; k < DIM*DIM; ++k )
+        val[k] = 0;
+}
+
+
+MatrixSparseSymmetricBlock::Block * MatrixSparseSymmetricBlock::findBlock( const index_type ii, const index_type jj ) const
+{
+    assert_true( ii >= jj );
+    for ( unsigned int kk = 0; kk < colSize[jj]; ++kk )
+        if ( col[jj][kk].line == ii )
+            return col[jj] + kk;
+    return 0;
+}
+
+
+/**
+ The blocks are kept ordered in the column, with the diagonal block first
+ */
+MatrixSparseSymmetricBlock::Block * MatrixSparseSymmetricBlock::getBlock( const index_type ii, const index_type jj )
+{
+    assert_true( ii >= jj );
+    assert_true( ii < mxBlocks );
+
+    Block * c;
+
+    //check if the column is empty:
+    if ( colSize[jj] == 0 )
+    {
+        c = allocateColumn( jj, 2 );
+
+        //diagonal block always first:
+        c->line = jj;
+        clearBlock(c->val);
+        colSize[jj] = 1;
+
+        if ( ii != jj )
+        {
+            //add the requested block:
+            ++c;
+            c->line = ii;
+            clearBlock(c->val);
+            colSize[jj] = 2;
+        }
+        return c;
+    }
+
+    c = col[jj];
+
+    if ( ii == jj )
+    {
+        assert_true( c->line == jj );
+        return c;
+    }
+
+    Block * e = c + 1;
+    Block * last = c + colSize[jj];
+
+    while ( e < last )
+    {
+        if ( e->line == ii )
+            return e;
+        if ( e->line > ii )
+            break;
+        ++e;
+    }
+
+    int indx = e - c;
+
+    //allocate space for new block if necessary:
+    if ( colMax[jj] <= colSize[jj] )
+    {
+        c = allocateColumn( jj, colSize[jj]+1 );
+        e = c + indx;
+    }
+
+    // shift the end of the column
+    for ( int k = colSize[jj]; k > indx; --k )
+        c[k] = c[k-1];
+    ++colSize[jj];
+
+    e->line = ii;
+    clearBlock(e->val);
+    return e;
+}
+
+
+real& MatrixSparseSymmetricBlock::operator()( index_type ii, index_type jj )
+{
+    assert_true( ii < mxSize );
+    assert_true( jj < mxSize );
+
+    //we swap to get the lower side
+    if ( jj > ii )
+    {
+        index_type tmp = ii;
+        ii = jj;
+        jj = tmp;
+    }
+
+    Block * b = getBlock( ii / DIM, jj / DIM );
+    return b->val[ ii % DIM + DIM * ( jj % DIM ) ];
+}
+
+
+real* MatrixSparseSymmetricBlock::addr( index_type ii, index_type jj ) const
+{
+    //we swap to get the order right
+    if ( jj > ii )
+    {
+        index_type tmp = ii;
+        ii  = jj;
+        jj  = tmp;
+    }
+
+    Block * b = findBlock( ii / DIM, jj / DIM );
+    if ( b )
+        return b->val + ( ii % DIM + DIM * ( jj % DIM ) );
+    return 0;
+}
+
+
+//------------------------------------------------------------------------------
+void MatrixSparseSymmetricBlock::makeZero()
+{
+    for ( unsigned int ii = 0; ii < mxBlocks; ++ii )
+        colSize[ii] = 0;
+}
+
+
+void MatrixSparseSymmetricBlock::scale( const real a )
+{
+    for ( unsigned int jj = 0; jj < mxBlocks; ++jj )
+        for ( unsigned int kk = 0; kk < colSize[jj]; ++kk )
+            for ( unsigned int n = 0; n < DIM*DIM; ++n )
+                col[jj][kk].val[n] *= a;
+}
+
+
+/**
+ Calls `FUNC(ii, jj, val)` for the elements of the lower triangle, including the diagonal.
+ For the diagonal blocks, the upper triangle is not used.
+ */
+#define FOR_EACH_ELEMENT(FUNC)                                          \
+for ( index_type bj = 0; bj < mxBlocks; ++bj )                          \
+{                                                                       \
+    for ( unsigned int kk = 0; kk < colSize[bj]; ++kk )                 \
+    {                                                                   \
+        Block const& blk = col[bj][kk];                                 \
+        for ( unsigned int c = 0; c < DIM; ++c )                        \
+        {                                                               \
+            for ( unsigned int r = ( kk ? 0 : c ); r < DIM; ++r )       \
+            {                                                           \
+                const index_type ii = DIM * blk.line + r;               \
+                const index_type jj = DIM * bj + c;                     \
+                FUNC(ii, jj, blk.val[r+DIM*c]);                         \
+            }                                                           \
+        }                                                               \
+    }                                                                   \
+}
+
+
+void MatrixSparseSymmetricBlock::addTriangularBlock(real* M, const index_type x, const unsigned int sx ) const
+{
+    assert_true( x + sx <= mxSize );
+
+#define ADD_TRIANGULAR(I, J, V)                                         \
+    if ( x <= J  &&  I < x + sx )                                       \
+        M[J-x+sx*(I-x)] += V;
+
+    FOR_EACH_ELEMENT(ADD_TRIANGULAR)
+#undef ADD_TRIANGULAR
+}
+
+
+void MatrixSparseSymmetricBlock::addDiagonalBlock(real* M, const index_type x, const unsigned int sx ) const
+{
+    assert_true( x + sx <= mxSize );
+
+#define ADD_DIAGONAL(I, J, V)                                           \
+    if ( x <= J  &&  I < x + sx )                                       \
+    {                                                                   \
+        M[I-x+sx*(J-x)] += V;                                           \
+        if ( I != J )                                                   \
+            M[J-x+sx*(I-x)] += V;                                       \
+    }
+
+    FOR_EACH_ELEMENT(ADD_DIAGONAL)
+#undef ADD_DIAGONAL
+}
+
+
+/**
+ M should be of size (kd+1)*sx, and uses the LAPACK symmetric band storage:
+ element (i, j) with i <= j is stored in M[kd+i-j+(kd+1)*j]
+ */
+void MatrixSparseSymmetricBlock::addDiagonalBand(real* M, const index_type x, const unsigned int sx, const unsigned int kd ) const
+{
+    assert_true( x + sx <= mxSize );
+
+#define ADD_BAND(I, J, V)                                               \
+    if ( x <= J  &&  I < x + sx  &&  I <= J + kd )                      \
+        M[kd+J-I+(kd+1)*(I-x)] += V;
+
+    FOR_EACH_ELEMENT(ADD_BAND)
+#undef ADD_BAND
+}
+
+
+void MatrixSparseSymmetricBlock::vecMulAddIso2D( const real* X, real* Y ) const
+{
+#define MUL_ISO2D(I, J, V)                                              \
+    {                                                                   \
+        Y[2*I  ] += V * X[2*J  ];                                       \
+        Y[2*I+1] += V * X[2*J+1];                                       \
+        if ( I != J )                                                   \
+        {                                                               \
+            Y[2*J  ] += V * X[2*I  ];                                   \
+            Y[2*J+1] += V * X[2*I+1];                                   \
+        }                                                               \
+    }
+
+    FOR_EACH_ELEMENT(MUL_ISO2D)
+#undef MUL_ISO2D
+}
+
+
+void MatrixSparseSymmetricBlock::vecMulAddIso3D( const real* X, real* Y ) const
+{
+#define MUL_ISO3D(I, J, V)                                              \
+    {                                                                   \
+        Y[3*I  ] += V * X[3*J  ];                                       \
+        Y[3*I+1] += V * X[3*J+1];                                       \
+        Y[3*I+2] += V * X[3*J+2];                                       \
+        if ( I != J )                                                   \
+        {                                                               \
+            Y[3*J  ] += V * X[3*I  ];                                   \
+            Y[3*J+1] += V * X[3*I+1];                                   \
+            Y[3*J+2] += V * X[3*I+2];                                   \
+        }                                                               \
+    }
+
+    FOR_EACH_ELEMENT(MUL_ISO3D)
+#undef MUL_ISO3D
+}
+
+
+void MatrixSparseSymmetricBlock::printSparse(std::ostream & os) const
+{
+#define PRINT_ELEMENT(I, J, V)                                          \
+    os << I << " " << J << " " << std::setprecision(8) << V << std::endl;
+
+    FOR_EACH_ELEMENT(PRINT_ELEMENT)
+#undef PRINT_ELEMENT
+}
+
+
+bool MatrixSparseSymmetricBlock::nonZero() const
+{
+    //check for any non-zero sparse term:
+    for ( unsigned int jj = 0; jj < mxBlocks; ++jj )
+        for ( unsigned int kk = 0; kk < colSize[jj]; ++kk )
+            for ( unsigned int n = 0; n < DIM*DIM; ++n )
+                if ( col[jj][kk].val[n] )
+                    return true;
+
+    //if here, the matrix is empty
+    return false;
+}
+
+
+unsigned int MatrixSparseSymmetricBlock::nbNonZeroElements() const
+{
+    //all allocated blocks are counted, even if zero
+    unsigned int cnt = 0;
+    for ( unsigned int jj = 0; jj < mxBlocks; ++jj )
+        cnt += colSize[jj];
+    return cnt * DIM * DIM;
+}
+
+
+/**
+ All the allocated elements are considered, even if they are zero
+ */
+void MatrixSparseSymmetricBlock::joinLines(index_type* parent, const unsigned int div) const
+{
+#define JOIN_LINES(I, J, V)                                             \
+    joinRoots(parent, I / div, J / div);
+
+    FOR_EACH_ELEMENT(JOIN_LINES)
+#undef JOIN_LINES
+}
+
+
+std::string MatrixSparseSymmetricBlock::what() const
+{
+    std::ostringstream msg;
+#if MATRIX_USES_INTEL_SSE3
+    msg << "SPSBi (nnz: " << nbNonZeroElements() << ")";
+#else
+    msg << "SPSB (nnz: " << nbNonZeroElements() << ")";
+#endif
+    return msg.str();
+}
+
+
+//------------------------------------------------------------------------------
+#pragma mark -
+
+/**
+ The upper triangle of the diagonal blocks is set from the lower triangle,
+ and the off-diagonal blocks are listed by lines, by increasing column.
+ */
+void MatrixSparseSymmetricBlock::prepareForMultiply()
+{
+    unsigned int nbl = 0;
+
+    for ( index_type ii = 0; ii <= mxBlocks; ++ii )
+        lnkStart[ii] = 0;
+
+    for ( index_type jj = 0; jj < mxBlocks; ++jj )
+    {
+        if ( colSize[jj] > 0 )
+        {
+            real * val = col[jj][0].val;
+            assert_true( col[jj][0].line == jj );
+            for ( unsigned int c = 0; c < DIM; ++c )
+                for ( unsigned int r = c+1; r < DIM; ++r )
+                    val[c+DIM*r] = val[r+DIM*c];
+
+            for ( unsigned int kk = 1; kk < colSize[jj]; ++kk )
+                ++lnkStart[col[jj][kk].line];
+            nbl += colSize[jj] - 1;
+        }
+    }
+
+    if ( nbl > lnkMax )
+    {
+        if ( lnk )
+            delete[] lnk;
+        lnkMax = nbl + mxBlocks;
+        lnk = new Link[lnkMax];
+    }
+
+    // convert counts to offsets:
+    unsigned int off = 0;
+    for ( index_type ii = 0; ii <= mxBlocks; ++ii )
+    {
+        unsigned int n = lnkStart[ii];
+        lnkStart[ii] = off;
+        off += n;
+    }
+
+    // fill, using lnkStart[ii] as a cursor for line ii:
+    for ( index_type jj = 0; jj < mxBlocks; ++jj )
+    {
+        for ( unsigned int kk = 1; kk < colSize[jj]; ++kk )
+        {
+            Link & k = lnk[lnkStart[col[jj][kk].line]++];
+            k.col = jj;
+            k.blk = col[jj] + kk;
+        }
+    }
+
+    // the cursors are now at the start of the next line:
+    for ( index_type ii = mxBlocks; ii > 0; --ii )
+        lnkStart[ii] = lnkStart[ii-1];
+    lnkStart[0] = 0;
+}
+
+
+#if MATRIX_USES_INTEL_SSE3
+
+#include <pmmintrin.h>
+#warning "Manual SSE3 code in MatrixSparseSymmetricBlock"
+
+#define SSE(x) _mm_##x##_pd
+
+/**
+ Each line of blocks is calculated independently, adding:
+ - the blocks of the line below the diagonal, by increasing column,
+ - the diagonal block,
+ - the transposed blocks of the column below the diagonal.
+ .
+ */
+void MatrixSparseSymmetricBlock::vecMulAdd( const real* X, real* Y, const index_type start, const index_type stop ) const
+{
+    assert_true( start % DIM == 0  &&  stop % DIM == 0 );
+    assert_true( stop <= mxSize );
+
+    for ( index_type jj = start/DIM; jj < stop/DIM; ++jj )
+    {
+        __m128d y = SSE(load)(Y+2*jj);
+
+        for ( Link const* k = lnk + lnkStart[jj]; k < lnk + lnkStart[jj+1]; ++k )
+        {
+            real const* a = k->blk->val;
+            real const* x = X + 2 * k->col;
+            y = SSE(add)(y, SSE(mul)(SSE(loadu)(a  ), SSE(loaddup)(x  )));
+            y = SSE(add)(y, SSE(mul)(SSE(loadu)(a+2), SSE(loaddup)(x+1)));
+        }
+
+        if ( colSize[jj] > 0 )
+        {
+            Block const* blk = col[jj];
+            real const* a = blk->val;
+            real const* x = X + 2 * jj;
+            y = SSE(add)(y, SSE(mul)(SSE(loadu)(a  ), SSE(loaddup)(x  )));
+            y = SSE(add)(y, SSE(mul)(SSE(loadu)(a+2), SSE(loaddup)(x+1)));
+
+            for ( Block const* b = blk + 1; b < blk + colSize[jj]; ++b )
+            {
+                __m128d xx = SSE(load)(X+2*b->line);
+                __m128d t0 = SSE(mul)(SSE(loadu)(b->val  ), xx);
+                __m128d t1 = SSE(mul)(SSE(loadu)(b->val+2), xx);
+                y = SSE(add)(y, SSE(hadd)(t0, t1));
+            }
+        }
+        SSE(store)(Y+2*jj, y);
+    }
+}
+
+#else
+
+/**
+ Each line of blocks is calculated independently, adding:
+ - the blocks of the line below the diagonal, by increasing column,
+ - the diagonal block,
+ - the transposed blocks of the column below the diagonal.
+ .
+ */
+void MatrixSparseSymmetricBlock::vecMulAdd( const real* X, real* Y, const index_type start, const index_type stop ) const
+{
+    assert_true( start % DIM == 0  &&  stop % DIM == 0 );
+    assert_true( stop <= mxSize );
+
+    for ( index_type jj = start/DIM; jj < stop/DIM; ++jj )
+    {
+        real y[DIM];
+        for ( unsigned int r = 0; r < DIM; ++r )
+            y[r] = Y[DIM*jj+r];
+
+        for ( Link const* k = lnk + lnkStart[jj]; k < lnk + lnkStart[jj+1]; ++k )
+        {
+            real const* a = k->blk->val;
+            real const* x = X + DIM * k->col;
+            for ( unsigned int c = 0; c < DIM; ++c )
+                for ( unsigned int r = 0; r < DIM; ++r )
+                    y[r] += a[r+DIM*c] * x[c];
+        }
+
+        if ( colSize[jj] > 0 )
+        {
+            Block const* blk = col[jj];
+            real const* a = blk->val;
+            real const* x = X + DIM * jj;
+            for ( unsigned int c = 0; c < DIM; ++c )
+                for ( unsigned int r = 0; r < DIM; ++r )
+                    y[r] += a[r+DIM*c] * x[c];
+
+            for ( Block const* b = blk + 1; b < blk + colSize[jj]; ++b )
+            {
+                a = b->val;
+                x = X + DIM * b->line;
+                for ( unsigned int c = 0; c < DIM; ++c )
+                    for ( unsigned int r = 0; r < DIM; ++r )
+                        y[c] += a[r+DIM*c] * x[r];
+            }
+        }
+
+        for ( unsigned int r = 0; r < DIM; ++r )
+            Y[DIM*jj+r] = y[r];
+    }
+}
+
+#endif
+
@@ -0,0 +1,155 @@
+// Cytosim was created by Francois Nedelec. Copyright 2007-2017 EMBL.
+
+#ifndef MATSPARSESYMBLK_H
+#define MATSPARSESYMBLK_H
+
+#include <cstdio>
+#include "dim.h"
+#include "matrix.h"
+
+
+///real symmetric sparse Matrix, made of blocks of size DIM x DIM
+/**
+ MatrixSparseSymmetricBlock stores the lower triangle of a symmetric matrix of size DIM*N,
+ as arrays of blocks of size DIM x DIM for each column of blocks.
+ A block is created when one of its elements is accessed, and its values
+ are stored contiguously in column-major order, next to a single index.
+ For the blocks on the diagonal, only the lower triangle is used.
+
+ This is efficient if the elements are set by blocks, as it is the case
+ for the anisotropic interactions in Meca, since the index traffic in the
+ multiplication by a vector is divided by DIM*DIM, and the block products
+ are vectorized.
+
+ As in MatrixSparseSymmetric1, the blocks are also listed by lines in prepareForMultiply(),
+ such that any range of lines of the product by a vector can be calculated independently.
+ */
+class MatrixSparseSymmetricBlock : public Matrix
+{
+
+private:
+
+    /// a block of DIM x DIM values
+    struct Block
+    {
+        real        val[DIM*DIM];  ///< values in column-major order
+        index_type  line;          ///< index of the line of blocks
+    };
+
+    /// reference to a block, used to list the blocks by lines
+    struct Link
+    {
+        index_type    col;         ///< index of the column of blocks
+        Block const*  blk;         ///< the block
+    };
+
+private:
+
+    /// size of matrix
+    unsigned int mxSize;
+
+    /// number of lines and columns of blocks
+    unsigned int mxBlocks;
+
+    /// number of columns of blocks which have been allocated
+    unsigned int mxAllocated;
+
+    /// array col[c][] holds the blocks of column 'c', starting with the diagonal block
+    Block ** col;
+
+    /// colSize[c] is the number of blocks in column 'c'
+    unsigned int  * colSize;
+
+    /// colMax[c] number of blocks allocated in column 'c'
+    unsigned int  * colMax;
+
+    /// the off-diagonal blocks of line 'l' are lnk[lnkStart[l]] to lnk[lnkStart[l+1]-1]
+    unsigned int  * lnkStart;
+
+    /// array of references to blocks, ordered by lines
+    Link          * lnk;
+
+    /// allocated size of lnk[]
+    unsigned int    lnkMax;
+
+    /// allocate column to hold specified number of blocks
+    Block * allocateColumn( index_type column_index, unsigned nb );
+
+    /// return the block at line `ii` and column `jj`, with ii >= jj, or zero
+    Block * findBlock( index_type ii, index_type jj ) const;
+
+    /// return the block at line `ii` and column `jj`, with ii >= jj, allocating if necessary
+    Block * getBlock( index_type ii, index_type jj );
+
+public:
+
+    //size of (square) matrix
+    unsigned int size() const { return mxSize; }
+
+    /// base for destructor
+    void deallocate();
+
+    /// default constructor
+    MatrixSparseSymmetricBlock();
+
+    /// default destructor
+    virtual ~MatrixSparseSymmetricBlock()  { deallocate(); }
+
+    /// set all the element to zero
+    void makeZero();
+
+    /// allocate the matrix to hold ( sz * sz )
+    void allocate( unsigned int sz );
+
+    /// returns the address of element at (x, y), no allocation is done
+    real* addr( index_type x, index_type y ) const;
+
+    /// returns the address of element at (x, y), allocating if necessary
+    real& operator()( index_type x, index_type y );
+
+    /// scale the matrix by a scalar factor
+    void scale( real a );
+
+    /// add the diagonal block ( x, x, x+sx, x+sx ) from this matrix to M
+    void addDiagonalBlock( real* M, index_type x, unsigned int sx) const;
+
+    /// add the upper triagular block ( x, x, x+sx, x+sx ) from this matrix to M
+    void addTriangularBlock( real* M, index_type x, unsigned int sx) const;
+
+    /// add the elements of the block ( x, x, x+sx, x+sx ) that are within `kd` of the diagonal to M, in symmetric band storage
+    void addDiagonalBand( real* M, index_type x, unsigned int sx, unsigned int kd) const;
+
+    /// list the blocks by lines, and symmetrize the diagonal blocks
+    void prepareForMultiply();
+
+    /// multiplication of a vector: Y = Y + M * X, dim(X) = dim(M)
+    void vecMulAdd( const real* X, real* Y ) const { vecMulAdd(X, Y, 0, mxSize); }
+
+    /// calculate the lines [start, stop[ of Y = Y + M * X, where start and stop are multiples of DIM
+    void vecMulAdd( const real* X, real* Y, index_type start, index_type stop ) const;
+
+    /// 2D isotropic multiplication of a vector: Y = Y + M * X
+    void vecMulAddIso2D( const real* X, real* Y ) const;
+
+    /// 3D isotropic multiplication of a vector: Y = Y + M * X
+    void vecMulAddIso3D( const real* X, real* Y ) const;
+
+    /// true if matrix is non-zero
+    bool nonZero() const;
+
+    /// number of blocks multiplied by the size of a block
+    unsigned int  nbNonZeroElements() const;
+    
+    /// join the lines connected by an element, in the union-find forest `parent`
+    void joinLines(index_type* parent, unsigned int div) const;
+
+    /// returns a string which a description of the type of matrix
+    std::string what() const;
+
+    /// printf debug function in sparse mode: i, j : value
+    void printSparse(std::ostream &) const;
+};
+
+
+#endif
+
@@ -0,0 +1,204 @@
+// Cytosim was created by Francois Nedelec. Copyright 2007-2017 EMBL.
+
+#include "philox.h"
+#include "assert_macro.h"
+
+
+/// multipliers of the Philox4x32 round
+static const uint32_t PHILOX_M0 = 0xD2511F53U, PHILOX_M1 = 0xCD9E8D57U;
+
+/// Weyl sequence used to bump the key between rounds
+static const uint32_t PHILOX_W0 = 0x9E3779B9U, PHILOX_W1 = 0xBB67AE85U;
+
+
+/// one round of Philox4x32, modifying `c`
+static inline void philoxRound(uint32_t c[4], const uint32_t k0, const uint32_t k1)
+{
+    uint64_t p0 = (uint64_t)PHILOX_M0 * c[0];
+    uint64_t p1 = (uint64_t)PHILOX_M1 * c[2];
+    uint32_t x0 = (uint32_t)( p1 >> 32 ) ^ c[1] ^ k0;
+    uint32_t x2 = (uint32_t)( p0 >> 32 ) ^ c[3] ^ k1;
+    c[0] = x0;
+    c[1] = (uint32_t)p1;
+    c[2] = x2;
+    c[3] = (uint32_t)p0;
+}
+
+
+void Philox::bijection(const uint32_t c[4], const uint32_t k[2], uint32_t res[4])
+{
+    res[0] = c[0];
+    res[1] = c[1];
+    res[2] = c[2];
+    res[3] = c[3];
+    uint32_t k0 = k[0], k1 = k[1];
+    for ( int r = 0; r < 9; ++r )
+    {
+        philoxRound(res, k0, k1);
+        k0 += PHILOX_W0;
+        k1 += PHILOX_W1;
+    }
+    philoxRound(res, k0, k1);
+}
+
+//------------------------------------------------------------------------------
+
+Philox::Philox()
+{
+    seed(1, 0, 0);
+}
+
+
+Philox::Philox(uint32_t s, uint32_t step, uint32_t id)
+{
+    seed(s, step, id);
+}
+
+
+void Philox::seed(uint32_t s, uint32_t step, uint32_t id)
+{
+    key[0] = s;
+    key[1] = id;
+    ctr[3] = 0;
+    setStep(step);
+}
+
+
+void Philox::setStep(uint32_t step)
+{
+    ctr[2] = step;
+    setBlock(0);
+}
+
+
+/**
+ This discards the values remaining in the current block
+ */
+void Philox::setBlock(uint64_t n)
+{
+    ctr[0] = (uint32_t)n;
+    ctr[1] = (uint32_t)( n >> 32 );
+    inx = 4;
+    bufferValue = 0;
+    bufferValid = false;
+}
+
+
+void Philox::refill()
+{
+    bijection(ctr, key, blk);
+    // increment the 64-bit block index:
+    if ( ++ctr[0] == 0 )
+        ++ctr[1];
+    inx = 0;
+}
+
+//------------------------------------------------------------------------------
+#pragma mark -
+
+/**
+ Signed real number, following a normal law N(0,1)
+ using the polar rejection method, as Random::gauss()
+ */
+real Philox::gauss()
+{
+    if ( bufferValid )
+    {
+        bufferValid = false;
+        return bufferValue;
+    }
+    else
+    {
+        real x, y, w;
+        do {
+            x = sreal();
+            y = sreal();
+            w = x * x + y * y;
+        } while ( w >= 1.0  ||  w == 0 );
+        w = sqrt( -2 * log(w) / w );
+        bufferValue = w * x;
+        bufferValid = true;
+        return w * y;
+    }
+}
+
+
+void Philox::gauss_pair(real & a, real & b)
+{
+    real x, y, w;
+    do {
+        x = sreal();
+        y = sreal();
+        w = x * x + y * y;
+    } while ( w >= 1.0  ||  w == 0 );
+    w = sqrt( -2 * log(w) / w );
+    a = w * x;
+    b = w * y;
+}
+
+
+/**
+ Fill \a n values in array \a vec[] with Gaussian ~ N(0,1).
+ */
+void Philox::gauss_array(unsigned int n, real vec[])
+{
+    unsigned int u = n % 2;
+
+    if ( u )
+        vec[0] = gauss();
+
+    for ( ; u < n; u += 2 )
+        gauss_pair(vec[u], vec[u+1]);
+}
+
+//------------------------------------------------------------------------------
+#pragma mark -
+
+/**
+ Return Poisson distributed integer, with expectation=E  variance=E
+ See Random::poisson()
+ */
+uint32_t Philox::poisson(const real E)
+{
+    if ( E > 256 )
+        return static_cast<uint32_t>( gauss() * sqrt(E) + E );
+
+    assert_true( E >= 0 );
+
+    real p = exp(-E);
+    real s = p;
+    uint32_t k = 0;
+    real u = preal();
+    while ( u > s )
+    {
+        ++k;
+        p *= E / k;
+        s += p;
+    }
+    return k;
+}
+
+
+uint32_t Philox::geometric(const real P)
+{
+    assert_true( P >= 0 );
+    uint32_t pi = (uint32_t)( P * 0x1p32 );
+
+    uint32_t s = 0;
+    while ( RAN32() > pi )
+        ++s;
+    return s;
+}
+
+
+uint32_t Philox::binomial(const int N, const real P)
+{
+    assert_true( P >= 0 );
+    uint32_t pi = (uint32_t)( P * 0x1p32 );
+
+    uint32_t s = 0;
+    for ( int x = 0; x < N; ++x )
+        if ( RAN32() < pi )
+            ++s;
+    return s;
+}
@@ -0,0 +1,153 @@
+// Cytosim was created by Francois Nedelec. Copyright 2007-2017 EMBL.
+
+#ifndef PHILOX_H
+#define PHILOX_H
+
+#include <stdint.h>
+#include <cmath>
+#include "real.h"
+
+
+/// Counter-based Random Number Generator
+/**
+ This implements Philox4x32-10, from:
+
+ Parallel Random Numbers: As Easy as 1, 2, 3
+ J. K. Salmon, M. A. Moraes, R. O. Dror and D. E. Shaw, SC'11 (2011)
+ http://www.thesalmons.org/john/random123/
+
+ Each block of 4 random numbers is a bijection of a 128-bit counter,
+ parametrized by a 64-bit key. There is no other state than the key and
+ the counter, and a stream is entirely determined by:
+ - the seed and the object identifier, forming the key,
+ - the step, which is stored in the upper part of the counter.
+ .
+ Different objects or threads can thus generate independent sequences
+ without any communication, and the numbers obtained by an object
+ do not depend on the order in which the objects are processed.
+ The lower 64 bits of the counter enumerate the blocks in a stream.
+
+ The interface follows the one of Random.
+*/
+class Philox
+{
+private:
+
+    /// the key
+    uint32_t  key[2];
+
+    /// the counter of the current block
+    uint32_t  ctr[4];
+
+    /// the current block of random bits
+    uint32_t  blk[4];
+
+    /// index of the next unused value in blk[]
+    unsigned  inx;
+
+    /// used by gauss()
+    real      bufferValue;
+
+    /// used by gauss()
+    bool      bufferValid;
+
+    /// calculate blk[] from ctr[] and key[], and increment the counter
+    void      refill();
+
+    /// extract next random uint32
+    inline uint32_t RAN32()
+    {
+        if ( inx > 3 )
+            refill();
+        return blk[inx++];
+    }
+
+public:
+
+    /// calculate the 10 rounds of Philox4x32 for counter `c` and key `k`, setting `res`
+    static void bijection(const uint32_t c[4], const uint32_t k[2], uint32_t res[4]);
+
+    /// Constructor
+    Philox();
+
+    /// Constructor with a key
+    Philox(uint32_t s, uint32_t step, uint32_t id);
+
+    /// set the key from (seed, object id) and start the stream of given step
+    void      seed(uint32_t s, uint32_t step, uint32_t id);
+
+    /// start the stream corresponding to another step, keeping the same key
+    void      setStep(uint32_t step);
+
+    /// move to the block `n` of the current stream
+    void      setBlock(uint64_t n);
+
+    /// unsigned integer in [0,2^32-1]
+    uint32_t  pint()                     { return RAN32(); }
+
+    /// unsigned integer in [0,n-1] for n < 2^32
+    uint32_t  pint_exc(const uint32_t n) { return uint32_t(RAN32() * (n*0x1p-32)); }
+
+    /// unsigned integer in [0,n] for n < 2^32
+    uint32_t  pint_inc(const uint32_t n) { return pint_exc(n+1); }
+
+    /// signed integer in [-2^31+1,2^31-1]
+    int32_t   sint()                     { return static_cast<int32_t>(RAN32()); }
+
+    /// integer in [-N, N], boundaries included
+    int32_t   sint_inc(const int32_t n)  { return pint_exc( 2*n+1 ) - n; }
+
+    /// integer k of probability distribution p(k,E) = exp(-E) * pow(E,k) / factorial(k)
+    uint32_t  poisson(real E);
+
+    /// number of successive unsuccessful trials, when success has probability p (result >= 0)
+    uint32_t  geometric(real p);
+
+    /// number of sucesses among n trials of probability p
+    uint32_t  binomial(int n, real p);
+
+    /// true with probability (p), false with probability (1-p)
+    bool      test(real const& p)        { return ( RAN32() < p * 0x1p32 ); }
+
+    /// true with probability (1-p), false with probability (p)
+    bool      test_not(real const& p)    { return ( RAN32() >= p * 0x1p32 ); }
+
+    /// true  or  false  with equal chance
+    bool      flip()                     { return RAN32() & 1024; }
+
+    /// returns -1  or  1 with equal chance
+    int       sflip()                    { return RAN32() & 1024 ? -1 : 1; }
+
+    /// positive real number in [0,1[, zero included
+    real      preal()                    { return RAN32() * 0x1p-32; }
+
+    /// signed real number in ]-1,1[, boundaries excluded
+    real      sreal()                    { return (int32_t)(RAN32()) * 0x1p-31; }
+
+    /// non-zero real number in ]0,1]
+    real      preal_exc()                { return RAN32() * 0x1p-32 + 0x1p-32; }
+
+    /// non-zero real number in ]0,n]
+    real      preal_exc(real n)          { return preal_exc() * n; }
+
+    /// real number uniformly in [a,b]
+    real      real_range(real a, real b) { return a + preal() * ( b - a ); }
+
+    /// random Gaussian number, following a normal law N(0,1)
+    real      gauss();
+
+    /// set two number, following a normal law N(0,1)
+    void      gauss_pair(real &, real &);
+
+    /// fill array \a vec with normal law N(0,1).
+    void      gauss_array(unsigned int n, real vec[]);
+
+    /// positive real x, according to distribution P(x) = exp(-x), expectancy = 1.0
+    real      exponential() { return -log( preal_exc() );  }
+
+    /// positive real x, with distribution P(x) = exp(-x/E) / E    : [ E = 1/Rate ]
+    real      exponential(const real E) { return -E * log( preal_exc() );  }
+
+};
+
+#endif  //PHILOX_H
@@ -2,7 +2,6 @@
 
 #include "pointsonsphere.h"
 
-extern Random RNG;
 
 
 //------------------------------------------------------------------------------
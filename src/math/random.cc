@@ -7,8 +7,15 @@
 #include <sys/time.h>
 #include <time.h>
 
+uint32_t Random::zkn[128];
+real     Random::zwn[128], Random::zfn[128];
+uint32_t Random::zke[256];
+real     Random::zwe[256], Random::zfe[256];
+
 ///RNG = Random Number Generator
-Random RNG;
+Random mainRNG;
+
+__thread Random * threadRNG = &mainRNG;
 
 //------------------------------------------------------------------------------
 Random::Random()
@@ -25,6 +32,8 @@ Random::Random()
     
     bufferValue = 0;
     bufferValid = false;
+    
+    setZiggurat();
 }
 
 Random::~Random()
@@ -127,29 +136,28 @@ void Random::gauss_pair(real & a, real & b)
 }
 
 /**
- Fill \a n values in array \a vec[] with Gaussian ~ N(0,1).
+ Fill \a n values in array \a vec[] with Gaussian ~ N(0,1), using gaussZ().
+ Only one random integer is used per value, except in the rare cases where
+ the value falls outside the core of the ziggurat.
  */
 void Random::gauss_array(unsigned int n, real vec[])
 {
-    unsigned int u = n % 8;
-    unsigned int w = u % 2;
-    
-    if ( w )
-        vec[0] = gauss();
-    
-    for ( ; w < u; w += 2 )
-        gauss_pair(vec[w], vec[w+1]);
-    
-    for ( ; u < n; u += 8 )
-    {
-        gauss_pair(vec[u  ], vec[u+1]);
-        gauss_pair(vec[u+2], vec[u+3]);
-        gauss_pair(vec[u+4], vec[u+5]);
-        gauss_pair(vec[u+6], vec[u+7]);
-    }
+    real * end = vec + n;
+    for ( ; vec < end; ++vec )
+        *vec = gaussZ();
 }
 
 
+/**
+ Fill \a n values in array \a vec[] with exponential ~ exp(-x)
+ */
+void Random::exponential_array(unsigned int n, real vec[])
+{
+    real * end = vec + n;
+    for ( ; vec < end; ++vec )
+        *vec = exponential();
+}
+
 /**
  this version uses cos() and sin() and is slower than gauss().
  const real PI = 3.14159265358979323846264338327950288;
@@ -175,6 +183,122 @@ real Random::gauss_slow()
 //------------------------------------------------------------------------------
 #pragma mark -
 
+/**
+ Calculate the tables used by gaussZ() and exponential(), following
+ 
+ The Ziggurat Method for Generating Random Variables
+ G. Marsaglia and W. W. Tsang, Journal of Statistical Software 5 (2000)
+ 
+ The values are here scaled for the 25 bits used by gaussZ(),
+ and the 24 bits used by exponential().
+ */
+void Random::setZiggurat()
+{
+    static bool ready = false;
+    if ( ready )
+        return;
+    
+    const double m1 = 0x1p24, m2 = 0x1p24;
+    
+    // normal law, 128 layers:
+    double dn = 3.442619855899, tn = dn, vn = 9.91256303526217e-3;
+    double q = vn / exp(-0.5*dn*dn);
+    zkn[0] = (uint32_t)((dn/q)*m1);
+    zkn[1] = 0;
+    zwn[0] = q / m1;
+    zwn[127] = dn / m1;
+    zfn[0] = 1.0;
+    zfn[127] = exp(-0.5*dn*dn);
+    for ( int i = 126; i >= 1; --i )
+    {
+        dn = sqrt(-2.0*log(vn/dn+exp(-0.5*dn*dn)));
+        zkn[i+1] = (uint32_t)((dn/tn)*m1);
+        tn = dn;
+        zfn[i] = exp(-0.5*dn*dn);
+        zwn[i] = dn / m1;
+    }
+    
+    // exponential law, 256 layers:
+    double de = 7.697117470131487, te = de, ve = 3.949659822581572e-3;
+    q = ve / exp(-de);
+    zke[0] = (uint32_t)((de/q)*m2);
+    zke[1] = 0;
+    zwe[0] = q / m2;
+    zwe[255] = de / m2;
+    zfe[0] = 1.0;
+    zfe[255] = exp(-de);
+    for ( int i = 254; i >= 1; --i )
+    {
+        de = -log(ve/de+exp(-de));
+        zke[i+1] = (uint32_t)((de/te)*m2);
+        te = de;
+        zfe[i] = exp(-de);
+        zwe[i] = de / m2;
+    }
+    
+    ready = true;
+}
+
+
+/**
+ The value `h` in layer `i` was outside the core of the ziggurat
+ */
+real Random::gaussTail(int32_t h, uint32_t i)
+{
+    const real R = 3.442619855899;
+    
+    while ( 1 )
+    {
+        real x = h * zwn[i];
+        if ( i == 0 )
+        {
+            // sample from the tail of the distribution, beyond R:
+            real y;
+            do {
+                x = -log(preal_exc()) / R;
+                y = -log(preal_exc());
+            } while ( y + y < x * x );
+            return ( h > 0 ) ? R + x : -R - x;
+        }
+        if ( zfn[i] + preal() * ( zfn[i-1] - zfn[i] ) < exp(-0.5*x*x) )
+            return x;
+        
+        uint32_t u = RAN32();
+        h = (int32_t)( u >> 7 ) - ( 1 << 24 );
+        i = u & 127;
+        if ( (uint32_t)( h < 0 ? -h : h ) < zkn[i] )
+            return h * zwn[i];
+    }
+}
+
+
+/**
+ The value `j` in layer `i` was outside the core of the ziggurat
+ */
+real Random::exponentialTail(uint32_t j, uint32_t i)
+{
+    const real R = 7.697117470131487;
+    
+    while ( 1 )
+    {
+        if ( i == 0 )
+            return R - log(preal_exc());
+        
+        real x = j * zwe[i];
+        if ( zfe[i] + preal() * ( zfe[i-1] - zfe[i] ) < exp(-x) )
+            return x;
+        
+        uint32_t u = RAN32();
+        j = u >> 8;
+        i = u & 255;
+        if ( j < zke[i] )
+            return j * zwe[i];
+    }
+}
+
+//------------------------------------------------------------------------------
+#pragma mark -
+
 /**
  integer in [0,n] for n < 2^32
  */
@@ -53,6 +53,35 @@ private:
     
     /// used by gauss()
     bool bufferValid;
+    
+    /// tables of the ziggurat for the normal law (128 layers)
+    static uint32_t zkn[128];
+    static real     zwn[128], zfn[128];
+    
+    /// tables of the ziggurat for the exponential law (256 layers)
+    static uint32_t zke[256];
+    static real     zwe[256], zfe[256];
+    
+    /// calculate the tables of the ziggurats
+    static void     setZiggurat();
+    
+    /// slow path of gaussZ()
+    real      gaussTail(int32_t, uint32_t);
+    
+    /// slow path of exponential()
+    real      exponentialTail(uint32_t, uint32_t);
+    
+    /// normal law N(0,1), using the ziggurat method of Marsaglia and Tsang
+    inline real gaussZ()
+    {
+        uint32_t u = RAN32();
+        // 25 upper bits for a signed value, 7 lower bits to select a layer:
+        int32_t  h = (int32_t)( u >> 7 ) - ( 1 << 24 );
+        uint32_t i = u & 127;
+        if ( (uint32_t)( h < 0 ? -h : h ) < zkn[i] )
+            return h * zwn[i];
+        return gaussTail(h, i);
+    }
 
 public:
             
@@ -153,17 +182,29 @@ public:
     /// set two number, following a normal law N(0,1)
     void      gauss_pair(real &, real &);
 
-    /// fill array \a vec with normal law N(0,1).
+    /// fill array \a vec with normal law N(0,1), using the ziggurat method
     void      gauss_array(unsigned int n, real vec[]);
 
     /// signed real number, following a normal law N(0,1), slower algorithm
     real      gauss_slow();
     
     /// positive real x, according to distribution P(x) = exp(-x), expectancy = 1.0
-    real      exponential() { return -log( preal_exc() );  }
+    /** This uses the ziggurat method of Marsaglia and Tsang, which avoids log() most of the time */
+    real      exponential()
+    {
+        uint32_t u = RAN32();
+        // 24 upper bits for the value, 8 lower bits to select a layer:
+        uint32_t j = u >> 8, i = u & 255;
+        if ( j < zke[i] )
+            return j * zwe[i];
+        return exponentialTail(j, i);
+    }
     
     /// positive real x, with distribution P(x) = exp(-x/E) / E    : [ E = 1/Rate ]
-    real      exponential(const real E) { return -E * log( preal_exc() );  }
+    real      exponential(const real E) { return E * exponential();  }
+    
+    /// fill array \a vec with exponential law of expectancy 1
+    void      exponential_array(unsigned int n, real vec[]);
 
     ///uniform choice among the 2 values given:  x,y
     template<typename T>
@@ -211,6 +252,20 @@ public:
 };
 
 
+/// the Random Number Generator of the main thread
+extern Random mainRNG;
+
+/// the Random Number Generator used by the calling thread, which is `mainRNG` by default
+/**
+ A thread that should draw numbers from an independent sequence can point
+ `threadRNG` to another Random object, and restore it afterwards.
+ */
+extern __thread Random * threadRNG;
+
+/// RNG designates the Random Number Generator of the calling thread
+#define RNG (*threadRNG)
+
+
 
 /**
  Linear congruential random number generator
@@ -8,7 +8,6 @@
 /**
  Random vectors are generated using the global Random Generator `RNG`
  */
-extern Random RNG;
 
 
 //------------------------------------------------------------------------------
@@ -13,7 +13,6 @@
 #include "simul.h"
 #include "space.h"
 #include "modulo.h"
-extern Random RNG;
 
 extern bool functionKey[];
 
@@ -96,13 +95,13 @@ void Bead::foldPosition(const Modulo * s)
 }
 
 
-real Bead::addBrownianForces(real* rhs, real sc) const
+real Bead::addBrownianForces(real const* rnd, real sc, real* rhs) const
 {
     // Brownian amplitude:
     real b = sqrt( 2 * sc * paDrag );
 
     for ( unsigned int jj = 0; jj < DIM*nbPoints(); ++jj )
-        rhs[jj] += b * RNG.gauss();
+        rhs[jj] += b * rnd[jj];
     
     //the amplitude is needed in Meca
     return b / paDrag;
@@ -126,7 +126,7 @@ public:
     void        setSpeedsFromForces(const real* X, real* Y, real, bool) const;
     
     /// add contribution of Brownian forces
-    real        addBrownianForces(real* rhs, real sc) const;
+    real        addBrownianForces(real const* rnd, real sc, real* rhs) const;
 
     /// add the interactions due to confinement
     void        setInteractions(Meca &) const;    
@@ -14,7 +14,6 @@
 #include "aster.h"
 #include "aster_prop.h"
 
-extern Random RNG;
 extern Modulo * modulo;
 
 //------------------------------------------------------------------------------
@@ -84,6 +84,12 @@ public:
 
     /// destructor
     virtual ~Couple();
+    
+    /// allocate memory from Hand::slab(), such that a Couple and its Hands are contiguous
+    static void * operator new(size_t s)               { return Hand::slab().allocate(s); }
+    
+    /// return memory to Hand::slab()
+    static void   operator delete(void * p, size_t s)  { Hand::slab().release(p, s); }
 
     /// copy operator
     Couple&  operator=(Couple const&);
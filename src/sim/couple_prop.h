@@ -19,6 +19,7 @@ class Space;
 class CoupleProp : public Property
 {
     friend class Couple;
+    friend class CoupleSet;
     
 public:
     
@@ -8,6 +8,8 @@
 #include "bridge_prop.h"
 #include "glossary.h"
 #include "simul.h"
+#include "nucleator.h"
+#include "thread_pool.h"
 
 
 /**
@@ -75,6 +77,7 @@ Property* CoupleSet::newProperty(const std::string& kd, const std::string& nm, G
 void CoupleSet::prepare(PropertyList& properties)
 {
     uni = uniPrepare(properties);
+    parallel = simul.prop->parallel_step && parallelPrepare(properties);
 }
 
 
@@ -84,6 +87,12 @@ void CoupleSet::step(FiberSet const& fibers, FiberGrid const& fgrid)
     if ( uni )
         uniAttach(fibers);
 
+    if ( parallel )
+    {
+        stepParallel(fgrid);
+        return;
+    }
+    
     /*
      ATTENTION: we have multiple lists, and Objects are automatically transfered
      from one list to another if their Hands bind or unbind. We ensure here that
@@ -149,6 +158,128 @@ void CoupleSet::relax()
     uniRelax();
 }
 
+//------------------------------------------------------------------------------
+#pragma mark - Parallel Step
+
+/**
+ The Hands that modify the Fibers cannot be stepped concurrently (see HandProp::concurrent()).
+ */
+bool CoupleSet::parallelPrepare(PropertyList& properties)
+{
+    PropertyList plist = properties.find_all("couple");
+    
+    for ( PropertyList::const_iterator n = plist.begin(); n != plist.end(); ++n )
+    {
+        CoupleProp const * p = static_cast<CoupleProp const*>(*n);
+        if ( !p->hand_prop1->concurrent()  ||  !p->hand_prop2->concurrent() )
+        {
+            MSG.warning("couple:%s cannot be stepped in parallel\n", p->name().c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/**
+ This steps the Couples of section `s` of each list, in the same order as step().
+ The lists are not modified, and the Hands that have changed Fiber are recorded.
+ */
+void CoupleSet::stepSection(const unsigned s, FiberGrid const& grid)
+{
+    Random * rng = threadRNG;
+    threadRNG = sectionRNG() + s;
+    
+    std::vector<Hand*>& mov = moved[s];
+    std::vector<Couple*>& chg = changed[s];
+    mov.clear();
+    chg.clear();
+    
+    for ( int L = 0; L < 4; ++L )
+    {
+        Node * const end = sections[L][s+1];
+        for ( Node * n = sections[L][s]; n != end; n = n->next() )
+        {
+            Couple * obj = static_cast<Couple*>(n);
+            Fiber const* fib1 = obj->fiber1();
+            Fiber const* fib2 = obj->fiber2();
+            
+            switch ( L )
+            {
+                case 0: obj->stepAA();     break;
+                case 1: obj->stepFA(grid); break;
+                case 2: obj->stepAF(grid); break;
+                case 3: obj->stepFF(grid); break;
+            }
+            
+            const bool mov1 = ( obj->fiber1() != fib1 );
+            const bool mov2 = ( obj->fiber2() != fib2 );
+            if ( mov1 )
+                mov.push_back(obj->cHand1);
+            if ( mov2 )
+                mov.push_back(obj->cHand2);
+            if ( mov1 || mov2 )
+                chg.push_back(obj);
+        }
+    }
+    
+    threadRNG = rng;
+}
+
+
+void CoupleSet::stepJob(void * arg, unsigned rank, unsigned nbt)
+{
+    CoupleSet * set = static_cast<CoupleSet*>(arg);
+    unsigned start, end;
+    ThreadPool::partition(NB_SECTIONS, rank, nbt, start, end);
+    for ( unsigned s = start; s < end; ++s )
+        set->stepSection(s, *set->jobGrid);
+}
+
+
+/**
+ The lists are divided into NB_SECTIONS sections, which are stepped concurrently,
+ each using its own Random Number Generator. The transfers of the Couples
+ between the lists are deferred, and applied afterwards in the order of the sections,
+ such that the results do not depend on the number of threads.
+ The Couples that change state are thus stepped only once.
+ Nucleations are also deferred (see Nucleator::nucleatePending()).
+ 
+ The FiberGrid should be in concurrent mode (see FiberGrid::setConcurrent()).
+ */
+void CoupleSet::stepParallel(FiberGrid const& grid)
+{
+    sectionRNG();
+    divideList(aaList, NB_SECTIONS, sections[0]);
+    divideList(faList, NB_SECTIONS, sections[1]);
+    divideList(afList, NB_SECTIONS, sections[2]);
+    divideList(ffList, NB_SECTIONS, sections[3]);
+    
+    jobGrid = &grid;
+    deferLinks(true);
+    FiberBinder::deferLinks = true;
+    
+    POOL.run(stepJob, this);
+    
+    FiberBinder::deferLinks = false;
+    deferLinks(false);
+    jobGrid = 0;
+    
+    for ( unsigned s = 0; s < NB_SECTIONS; ++s )
+    {
+        std::vector<Hand*>& mov = moved[s];
+        for ( std::vector<Hand*>::iterator h = mov.begin(); h != mov.end(); ++h )
+            (*h)->relinkBinder();
+        
+        std::vector<Couple*>& chg = changed[s];
+        for ( std::vector<Couple*>::iterator c = chg.begin(); c != chg.end(); ++c )
+            relink(*c);
+    }
+    
+    Nucleator::nucleatePending();
+}
+
+
 //------------------------------------------------------------------------------
 #pragma mark -
 
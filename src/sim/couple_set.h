@@ -66,11 +66,39 @@ private:
     
     /// return Couples in uniLists to the normal lists
     void         uniRelax();
+    
+    
+    /// flag to step the Couples on multiple threads
+    bool               parallel;
+    
+    /// sections[L][s] is the first Couple of section `s` of list L, in the order AA, FA, AF, FF
+    Node *             sections[4][NB_SECTIONS+1];
+    
+    /// the Hands that have changed Fiber in each section
+    std::vector<Hand*> moved[NB_SECTIONS];
+    
+    /// the Couples with Hands that have changed Fiber in each section
+    std::vector<Couple*> changed[NB_SECTIONS];
+    
+    /// the FiberGrid used by stepJob()
+    FiberGrid const*   jobGrid;
+    
+    /// true if all the Couples can be stepped concurrently
+    bool         parallelPrepare(PropertyList& properties);
+    
+    /// Monte-Carlo step for the Couples of section `s`
+    void         stepSection(unsigned s, FiberGrid const&);
+    
+    /// call stepSection() for a fraction of the sections
+    static void  stepJob(void*, unsigned rank, unsigned nbt);
+    
+    /// Monte-Carlo step on multiple threads
+    void         stepParallel(FiberGrid const&);
 
 public:
     
     ///creator
-    CoupleSet(Simul& s) : ObjectSet(s), ffList(this), afList(this), faList(this), aaList(this), uni(false) {}
+    CoupleSet(Simul& s) : ObjectSet(s), ffList(this), afList(this), faList(this), aaList(this), uni(false), parallel(false), jobGrid(0) {}
     
     ///destructor
     virtual ~CoupleSet() {}
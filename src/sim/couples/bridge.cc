@@ -8,7 +8,6 @@
 #include "random.h"
 
 extern Modulo* modulo;
-extern Random RNG;
 
 //------------------------------------------------------------------------------
 
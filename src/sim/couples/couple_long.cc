@@ -8,7 +8,6 @@
 #include "meca.h"
 
 extern Modulo* modulo;
-extern Random RNG;
 
 //------------------------------------------------------------------------------
 
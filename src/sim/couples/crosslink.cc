@@ -5,7 +5,6 @@
 #include "exceptions.h"
 #include "random.h"
 
-extern Random RNG;
 
 //------------------------------------------------------------------------------
 Crosslink::Crosslink(CrosslinkProp const* p, Vector const& w)
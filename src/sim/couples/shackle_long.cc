@@ -6,7 +6,6 @@
 #include "meca.h"
 
 extern Modulo * modulo;
-extern Random RNG;
 
 //------------------------------------------------------------------------------
 ShackleLong::ShackleLong(ShackleProp const* p, Vector const& w)
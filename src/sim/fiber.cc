@@ -563,6 +563,9 @@ FiberBinder * Fiber::firstBinder() const
 }
 
 
+bool Fiber::deferChecks = false;
+
+
 void Fiber::updateBinders()
 {
     //we iterate one step forward, because updating might lead to detachment:
@@ -573,7 +576,8 @@ void Fiber::updateBinders()
         FiberBinder * ha = static_cast<FiberBinder*>(hi);
         hi = hi->next();
         ha->updateBinder();
-        ha->checkFiberRange();
+        if ( !deferChecks )
+            ha->checkFiberRange();
     }
 }
 
@@ -154,6 +154,9 @@ public:
     /// a FiberBinder bound to this fiber (use ->next() to access all other binders)
     FiberBinder*   firstBinder() const;
     
+    /// if true, updateBinders() does not call FiberBinder::checkFiberRange()
+    static bool    deferChecks;
+    
     /// update all binders
     void           updateBinders();
     
@@ -8,6 +8,9 @@
 
 //------------------------------------------------------------------------------
 
+bool FiberBinder::deferLinks = false;
+
+
 FiberBinder::FiberBinder(Fiber* f, real a)
 : fbFiber(f), fbAbs(a)
 {
@@ -89,7 +92,8 @@ void FiberBinder::attach(FiberBinder & fb)
     assert_true(fbFiber->abscissaM() <= fbAbs);
     assert_true(fbAbs <= fbFiber->abscissaP());
 
-    fbFiber->addBinder(this);
+    if ( !deferLinks )
+        fbFiber->addBinder(this);
     updateBinder();
 }
 
@@ -97,11 +101,28 @@ void FiberBinder::attach(FiberBinder & fb)
 void FiberBinder::detach()
 {
     assert_true( fbFiber );
-    fbFiber->removeBinder(this);
+    if ( !deferLinks )
+        fbFiber->removeBinder(this);
     fbFiber = 0;
 }
 
 
+/**
+ While `deferLinks` is set, attach() and detach() do not modify the lists of the Fibers,
+ such that they can be called concurrently for different FiberBinders.
+ This should be called afterwards for any FiberBinder that may have changed Fiber,
+ to remove it from the list of its former Fiber, and add it to the list of the current one.
+ */
+void FiberBinder::relinkBinder()
+{
+    assert_true( !deferLinks );
+    if ( linked() )
+        list()->pop(this);
+    if ( fbFiber )
+        fbFiber->addBinder(this);
+}
+
+
 //------------------------------------------------------------------------------
 #pragma mark -
 
@@ -111,6 +111,12 @@ public:
     
     /// detach from Fiber (can be changed in derived Classes to allow updating)
     virtual void detach();
+    
+    /// if true, attach() and detach() do not update the list of FiberBinders of the Fiber
+    static bool  deferLinks;
+    
+    /// update the lists of FiberBinders, after attach() or detach() were called with `deferLinks`
+    void         relinkBinder();
 
     /// check the abscissa against the edges of the fiber, calling handleOutOfRange() if necessary.
     void         checkFiberRange();
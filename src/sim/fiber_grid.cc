@@ -13,7 +13,36 @@
 #include "hand_prop.h"
 #include "simul.h"
 #include "sim.h"
-extern Random RNG;
+#include "thread_pool.h"
+#include <cstdlib>
+
+
+FiberGrid::FiberGrid()
+{
+    modulo = 0;
+    gridRange = -1;
+    gridSkin = 0;
+    gridWidth = 0;
+    paintCount = 0;
+    nbSegments = 0;
+    nbPainted = 0;
+    nbPaintedTotal = 0;
+    batchMode = false;
+    concurrent = false;
+#if FIBER_GRID_COMPACT
+    cellSegs = 0;
+    cellSegsMax = 0;
+#endif
+}
+
+
+FiberGrid::~FiberGrid()
+{
+#if FIBER_GRID_COMPACT
+    delete[] cellSegs;
+#endif
+}
+
 
 #if ( 0 )
 // this includes a naive implementation, which is slow but helpful for debugging
@@ -78,13 +107,28 @@ int FiberGrid::setGrid(const Space * space, const Modulo * mod, real max_step, u
     else
         modulo = 0;
     
+    // the number of cells should be representable:
+    if ( real(nCells[0]) * real(nCells[1]) * real(nCells[2]) > 1e9 )
+        return 1;
+    
     mGrid.setDimensions(-range, range, nCells);
     
     // we check the number of cells, to avoid crazy memory requirements
+#if FIBER_GRID_SPARSE
+    // only the rows of cells that are used will be allocated:
+    if ( mGrid.nbCells() / mGrid.nbCells(0) > max_nb_cells )
+        return 1;
+#else
     if ( mGrid.nbCells() > max_nb_cells )
         return 1;
+#endif
     
     mGrid.createCells();
+    mGrid.clear();
+#if FIBER_GRID_COMPACT
+    usedCells.clear();
+#endif
+    records.clear();
     
     //report the grid size used
     MSG(5, "FiberGrid set with %i cells", mGrid.nbCells());
@@ -109,11 +153,19 @@ void FiberGrid::clear()
     // this is to be able to detect if paintGrid() is not called:
     gridRange = 0;
     
+#if FIBER_GRID_COMPACT
+    clearUsedCells();
+#else
     mGrid.clear();
+#endif
+    records.clear();
+    nbSegments = 0;
 }
 
 
 //------------------------------------------------------------------------------
+#if !FIBER_GRID_COMPACT
+
 /** 
  paintCell(x,y,z) adds a Segment to the SegmentList associated with
  the grid point (x,y,z). 
@@ -169,236 +221,1202 @@ void paintCellPeriodic(const int x_inf, const int x_sup, const int y, const int
     }
 }
 
-//------------------------------------------------------------------------------
+
 /**
-paintGrid( first_fiber, last_fiber, max_range ) links all segments found in 'fiber' and its
- descendant, in the point-list GP that match distance(GP, segment) < H.
- 
- 'H' is calculated such that tryToAttach() finds any segment closer than 'max_range':
- 
- To determine H, we start from a relation on the sides of a triangle:
- (A) distance( GP, segment ) < distance( GP, X ) + distance( X, segment )
- where GP (grid-point) is the closest point on the grid to X.
- 
- Since GP in tryToAttach() is the closest point on mGrid to X, we have:
- (B) distance( GP, X ) < 0.5 * mGrid.diagonalLength()
- 
- Thus to find all rods for which:
- (B) distance( X, segment ) < max_range
- we simply use:
- H =  max_range + 0.5 * mGrid.diagonalLength();
- 
- Note: H is calculated by paintGrid(), and the user only provides 'max_range'.
- 
- Linking all segments is done in an inverse way:
- for each segment, we cover all points of the grid inside a volume obtained
- by inflating the segment by the length H. We use for that the raterizer which
- calls the function paint() above.
+ eraseCell(x,y,z) removes a Segment from the SegmentList associated with
+ the grid points (x_inf to x_sup, y, z), by moving the last element into its place.
+ It is called by the rasterizer, with the same arguments that were used to paint the Segment.
  */
 
-void FiberGrid::paintGrid(const Fiber * first, const Fiber * last, const real max_range)
+void eraseCell(const int x_inf, const int x_sup, const int y, const int z, void * arg1, void * arg2)
 {
-    clear();
-    gridRange = max_range;
-    
-    assert_true(hasGrid());
+    FiberLocus const* seg = static_cast<FiberLocus const*>(arg1);
+    FiberGrid::grid_type * mGrid = static_cast<FiberGrid::grid_type *>(arg2);
     
-    const real* offset = mGrid.inf();
-    const real* deltas = mGrid.delta();
-    real width = gridRange + 0.5 * mGrid.diagonalLength();
+#if   ( DIM == 1 )
+    FiberGrid::SegmentList & inf = mGrid->cell1D( x_inf );
+    FiberGrid::SegmentList & sup = mGrid->cell1D( x_sup );
+#elif ( DIM == 2 )
+    FiberGrid::SegmentList & inf = mGrid->cell2D( x_inf, y );
+    FiberGrid::SegmentList & sup = mGrid->cell2D( x_sup, y );
+#elif ( DIM == 3 )
+    FiberGrid::SegmentList & inf = mGrid->cell3D( x_inf, y, z );
+    FiberGrid::SegmentList & sup = mGrid->cell3D( x_sup, y, z );
+#endif
     
-    //define the painting function used:
-    void (*paint)(int, int, int, int, void*, void*) = modulo ? paintCellPeriodic : paintCell;
+    for ( FiberGrid::SegmentList * list = &inf; list <= &sup; ++list )
+    {
+        int i = list->find(seg);
+        assert_true( i >= 0 );
+        if ( i < 0 )
+            continue;
+        unsigned last = list->size() - 1;
+        (*list)[i] = (*list)[last];
+        list->truncate(last);
+    }
+}
+
+
+/**
+ eraseCellPeriodic(x,y,z) removes a Segment from the SegmentList associated with
+ the grid points (x_inf to x_sup, y, z), for a periodic grid.
+ */
+
+void eraseCellPeriodic(const int x_inf, const int x_sup, const int y, const int z, void * arg1, void * arg2)
+{
+    FiberLocus const* seg = static_cast<FiberLocus const*>(arg1);
+    FiberGrid::grid_type * mGrid = static_cast<FiberGrid::grid_type *>(arg2);
     
-    for ( const Fiber * fib = first; fib != last ; fib=fib->next() )
+    for ( int x = x_inf; x <= x_sup; ++x )
     {
-        Vector Q, P = fib->posPoint(0);
-        real S = fib->segmentation();
-        
-        for ( unsigned pp = 1; pp < fib->nbPoints(); ++pp )
-        {
-            FiberLocus * seg = &(fib->segment(pp-1));
-            
-            if ( pp & 1 )
-                Q = fib->posPoint(pp);
-            else
-                P = fib->posPoint(pp);
-            
-#if   (DIM == 1)
-            Rasterizer::paintFatLine1D(paint, seg, &mGrid, P, Q, width, offset, deltas);
-#elif (DIM == 2)
-            Rasterizer::paintFatLine2D(paint, seg, &mGrid, P, Q, width, offset, deltas, S);
-#elif (DIM == 3)
-            //Rasterizer::paintHexLine3D(paint, seg, &mGrid, P, Q, width, offset, deltas, S);
-            Rasterizer::paintFatLine3D(paint, seg, &mGrid, P, Q, width, offset, deltas, S);
-            //Rasterizer::paintBox3D(paint, seg, &mGrid, P, Q, width, offset, deltas);
+#if   ( DIM == 1 )
+        FiberGrid::SegmentList & list = mGrid->cell1D( x );
+#elif ( DIM == 2 )
+        FiberGrid::SegmentList & list = mGrid->cell2D( x, y );
+#elif ( DIM == 3 )
+        FiberGrid::SegmentList & list = mGrid->cell3D( x, y, z );
 #endif
-        }
+        int i = list.find(seg);
+        assert_true( i >= 0 );
+        if ( i < 0 )
+            continue;
+        unsigned last = list.size() - 1;
+        list[i] = list[last];
+        list.truncate(last);
     }
 }
 
+#else
 
+/**
+ Reset the cells that were counted since the last call.
+ Only these cells can hold segments, such that the cost does not depend on the size of the grid.
+ */
+void FiberGrid::clearUsedCells()
+{
+    for ( unsigned u = 0; u < usedCells.size(); ++u )
+        mGrid.cell(usedCells[u]).clear();
+    usedCells.clear();
+}
 
-//============================================================================
-#pragma mark -
 
 /**
- The range at which Hand will the the Fibers is limited to the range given in paintGrid()
+ countCell() increments the number of segments of the cells (x_inf to x_sup, y, z).
+ It is called by the rasterizer during the first pass of paintGrid().
  */
-bool FiberGrid::tryToAttach(Vector const& place, Hand& ha) const
+void FiberGrid::countCell(const int x_inf, const int x_sup, const int y, const int z, void *, void * arg2)
 {
-    assert_true( hasGrid() );
-    
-    if ( gridRange < ha.prop->binding_range )
-    {
-        printf("Warning: the FiberGrid range was exceeded:\n");
-        //printf("  gridRange = %.3e < Hand::binding_range = %.3f\n", gridRange, ha.prop->binding_range);
-        //throw InvalidParameter("the FiberGrid range was exceeded");
-    }
-    
-    //get the grid node list index closest to the position in space:
-    const unsigned int indx = mGrid.index(place, 0.5);
-    
-    //get the list of rods associated with this cell:
-    SegmentList & segments = mGrid.cell(indx);
-   
-    //randomize the list, to make attachments more fair:
-    //this might not be necessary, since the MT list is already mixed
-    segments.mix(RNG);
+    FiberGrid * fg = static_cast<FiberGrid*>(arg2);
+
+#if   ( DIM == 1 )
+    SegmentRange * inf = &fg->mGrid.cell1D( x_inf );
+    SegmentRange * sup = &fg->mGrid.cell1D( x_sup );
+#elif ( DIM == 2 )
+    SegmentRange * inf = &fg->mGrid.cell2D( x_inf, y );
+    SegmentRange * sup = &fg->mGrid.cell2D( x_sup, y );
+#elif ( DIM == 3 )
+    SegmentRange * inf = &fg->mGrid.cell3D( x_inf, y, z );
+    SegmentRange * sup = &fg->mGrid.cell3D( x_sup, y, z );
+#endif
     
+    for ( SegmentRange * cell = inf; cell <= sup; ++cell )
+        fg->countSegment(cell);
+}
 
-    for ( SegmentList::iterator si = segments.begin(); si < segments.end(); ++si )
+
+void FiberGrid::countCellPeriodic(const int x_inf, const int x_sup, const int y, const int z, void *, void * arg2)
+{
+    FiberGrid * fg = static_cast<FiberGrid*>(arg2);
+    
+    for ( int x = x_inf; x <= x_sup; ++x )
     {
-        FiberLocus const* loc = *si;
-        
-        real abs, dis = INFINITY;
-        // Compute the distance from the hand to the rod:
-        loc->projectPoint(place, abs, dis);      // always works
-        //loc->projectPointF(place, abs, dis);    // faster, but not compatible with periodic boundaries
-        
-        // compare to the maximum attach distance of the hand:
-        if ( dis > ha.prop->binding_range_sqr )
-            continue;
-        
-        Fiber * fib = const_cast<Fiber*>(loc->fiber());
-        
-        FiberBinder site(fib, fib->abscissaP(loc->point())+abs);
-        
-        if ( ha.attachmentAllowed(site) )
-        {
-            ha.attach(site);
-            return true;
-        }
+#if   ( DIM == 1 )
+        fg->countSegment(&fg->mGrid.cell1D( x ));
+#elif ( DIM == 2 )
+        fg->countSegment(&fg->mGrid.cell2D( x, y ));
+#elif ( DIM == 3 )
+        fg->countSegment(&fg->mGrid.cell3D( x, y, z ));
+#endif
     }
-    
-    return false;
 }
 
 
-//------------------------------------------------------------------------------
-/** 
- This function is limited to the range given in paintGrid();
+/**
+ fillCell() adds a segment to the cells (x_inf to x_sup, y, z).
+ It is called by the rasterizer during the second pass of paintGrid(),
+ after the ranges of the cells have been set.
  */
-FiberGrid::SegmentList FiberGrid::nearbySegments( Vector const& place, const real D, Fiber * exclude)
+void FiberGrid::fillCell(const int x_inf, const int x_sup, const int y, const int z, void * arg1, void * arg2)
 {
-    if ( gridRange <= 0 )
-        throw InvalidParameter("the Grid was not initialized");
-    if ( gridRange < D )
-    {
-        printf("gridRange = %.4f < range = %.4f\n", gridRange, D);
-        throw InvalidParameter("the Grid maximum distance was exceeded");
-    }
-    
-    SegmentList res;
+    FiberLocus const* seg = static_cast<FiberLocus const*>(arg1);
+    FiberGrid * fg = static_cast<FiberGrid*>(arg2);
     
-    //get the grid node list index closest to the position in space:
-    const unsigned indx = mGrid.index( place, 0.5 );
+#if   ( DIM == 1 )
+    SegmentRange * inf = &fg->mGrid.cell1D( x_inf );
+    SegmentRange * sup = &fg->mGrid.cell1D( x_sup );
+#elif ( DIM == 2 )
+    SegmentRange * inf = &fg->mGrid.cell2D( x_inf, y );
+    SegmentRange * sup = &fg->mGrid.cell2D( x_sup, y );
+#elif ( DIM == 3 )
+    SegmentRange * inf = &fg->mGrid.cell3D( x_inf, y, z );
+    SegmentRange * sup = &fg->mGrid.cell3D( x_sup, y, z );
+#endif
     
-    //get the list of rods associated with this cell:
-    SegmentList & segments = mGrid.cell(indx);
+    for ( SegmentRange * cell = inf; cell <= sup; ++cell )
+        fg->cellSegs[cell->start+cell->cnt++] = seg;
+}
+
+
+void FiberGrid::fillCellPeriodic(const int x_inf, const int x_sup, const int y, const int z, void * arg1, void * arg2)
+{
+    FiberLocus const* seg = static_cast<FiberLocus const*>(arg1);
+    FiberGrid * fg = static_cast<FiberGrid*>(arg2);
     
-    const real DD = D*D;
-    for ( SegmentList::iterator si = segments.begin(); si < segments.end(); ++si )
+    for ( int x = x_inf; x <= x_sup; ++x )
     {
-        FiberLocus const* loc = *si;
-        
-        if ( loc->fiber() == exclude ) 
-            continue;
-        
-        real abs, dis = INFINITY;
-        loc->projectPoint(place, abs, dis);
-        
-        if ( dis < DD )
-            res.push_back(loc);
+#if   ( DIM == 1 )
+        SegmentRange & cell = fg->mGrid.cell1D( x );
+#elif ( DIM == 2 )
+        SegmentRange & cell = fg->mGrid.cell2D( x, y );
+#elif ( DIM == 3 )
+        SegmentRange & cell = fg->mGrid.cell3D( x, y, z );
+#endif
+        fg->cellSegs[cell.start+cell.cnt++] = seg;
     }
-    
-    return res;
 }
 
+#endif
+
+/**
+ Call `paint` for all the cells located within `width` of the segment [P, Q]
+ */
+void rasterize(void (*paint)(int, int, int, int, void*, void*), void * arg,
+               FiberLocus const* seg, FiberGrid::grid_type const& grid,
+               Vector const& P, Vector const& Q, real width, real S)
+{
+    const real* offset = grid.inf();
+    const real* deltas = grid.delta();
+    void * loc = const_cast<FiberLocus*>(seg);
+#if   (DIM == 1)
+    Rasterizer::paintFatLine1D(paint, loc, arg, P, Q, width, offset, deltas);
+#elif (DIM == 2)
+    Rasterizer::paintFatLine2D(paint, loc, arg, P, Q, width, offset, deltas, S);
+#elif (DIM == 3)
+    //Rasterizer::paintHexLine3D(paint, loc, arg, P, Q, width, offset, deltas, S);
+    Rasterizer::paintFatLine3D(paint, loc, arg, P, Q, width, offset, deltas, S);
+    //Rasterizer::paintBox3D(paint, loc, arg, P, Q, width, offset, deltas);
+#endif
+}
 
-//============================================================================
-//===                            ACCESSORY                                ====
-//============================================================================
 
-FiberLocus FiberGrid::closestSegment(Vector const& place)
+/**
+ Call `paint` with `arg` for all the segments of the Fiber
+ */
+void paintFiber(void (*paint)(int, int, int, int, void*, void*), void * arg,
+                const Fiber * fib, FiberGrid::grid_type const& grid, const real width)
 {
-    //get the cell index from the position in space:
-    const unsigned indx = mGrid.index( place, 0.5 );
-    
-    //get the list of rods associated with this cell:
-    SegmentList & segments =  mGrid.cell(indx);
-    
-    FiberLocus const* res = 0;
-    real closest = 4 * gridRange * gridRange;
+    Vector Q, P = fib->posPoint(0);
+    real S = fib->segmentation();
     
-    for ( SegmentList::iterator si = segments.begin(); si < segments.end(); ++si )
+    for ( unsigned pp = 1; pp < fib->nbPoints(); ++pp )
     {
-        FiberLocus const* loc = *si;
+        FiberLocus * seg = &(fib->segment(pp-1));
         
-        //we compute the distance from the hand to the candidate rod,
-        //and compare it to the best we have so far.
-        real abs, dis = INFINITY;
-        loc->projectPoint(place, abs, dis);
+        if ( pp & 1 )
+            Q = fib->posPoint(pp);
+        else
+            P = fib->posPoint(pp);
         
-        if ( dis < closest )
-        {
-            closest = dis;
-            res = loc;
-        }
+        rasterize(paint, arg, seg, grid, P, Q, width, S);
     }
-    return *res;
 }
 
 
-#endif
+/**
+ Call `paint` with `arg` for all the segments of the Fibers in [first, last[,
+ and set nbPainted
+ */
+void FiberGrid::paintFibers(void (*paint)(int, int, int, int, void*, void*), void * arg,
+                            const Fiber * first, const Fiber * last, const real width)
+{
+    nbPainted = 0;
+    for ( const Fiber * fib = first; fib != last ; fib=fib->next() )
+    {
+        paintFiber(paint, arg, fib, mGrid, width);
+        nbPainted += fib->nbSegments();
+    }
+}
 
 
-//============================================================================
-//===                       DEBUG  ATTACHMENT                             ====
-//============================================================================
+//------------------------------------------------------------------------------
 #pragma mark -
 
-#include <map>
-#include "simul.h"
-
 /**
-Function testAttach() is given a position in space,
- it calls tryToAttach() from this position to check that:
- - attachement has equal probability to all targets,
- - no target is missed,
- - attachment are not made to targets that are beyond binding_range_max
+ bufferRow() records that the cells (x_inf to x_sup, y, z) are covered by a segment.
+ It is called by the rasterizer in paintParallel(), with a PaintBuffer as `arg2`.
+ Only the indices of the cells are recorded, since the grid may allocate cells when they are accessed.
  */
-void FiberGrid::testAttach(FILE * out, const Vector pos, Fiber * start, HandProp const* hp)
+void FiberGrid::bufferRow(const int x_inf, const int x_sup, const int y, const int z, void * arg1, void * arg2)
 {
-    //create a test motor with a dummy HandMonitor:
-    HandMonitor hm;
-    Hand ha(hp, &hm);
-    real dsq = hp->binding_range_sqr;
-    
-    typedef std::map < FiberLocus const*, int > map_type;
-    map_type hits;
-    
-    //go through all the segments to find those close enough from pos:
+    PaintBuffer * buf = static_cast<PaintBuffer*>(arg2);
+    PaintedRow row;
+    row.seg = static_cast<FiberLocus const*>(arg1);
+#if   ( DIM == 1 )
+    row.inf = buf->grid->index1D( x_inf );
+    row.sup = buf->grid->index1D( x_sup );
+#elif ( DIM == 2 )
+    row.inf = buf->grid->index2D( x_inf, y );
+    row.sup = buf->grid->index2D( x_sup, y );
+#elif ( DIM == 3 )
+    row.inf = buf->grid->index3D( x_inf, y, z );
+    row.sup = buf->grid->index3D( x_sup, y, z );
+#endif
+    buf->rows.push_back(row);
+}
+
+
+void FiberGrid::bufferRowPeriodic(const int x_inf, const int x_sup, const int y, const int z, void * arg1, void * arg2)
+{
+    PaintBuffer * buf = static_cast<PaintBuffer*>(arg2);
+    PaintedRow row;
+    row.seg = static_cast<FiberLocus const*>(arg1);
+    for ( int x = x_inf; x <= x_sup; ++x )
+    {
+#if   ( DIM == 1 )
+        row.inf = buf->grid->index1D( x );
+#elif ( DIM == 2 )
+        row.inf = buf->grid->index2D( x, y );
+#elif ( DIM == 3 )
+        row.inf = buf->grid->index3D( x, y, z );
+#endif
+        row.sup = row.inf;
+        buf->rows.push_back(row);
+    }
+}
+
+
+/**
+ Each thread paints a contiguous range of paintList into its own buffer
+ */
+void FiberGrid::paintJob(void * arg, unsigned rank, unsigned nbt)
+{
+    FiberGrid * fg = static_cast<FiberGrid*>(arg);
+    PaintBuffer & buf = fg->paintBuffers[rank];
+    void (*paint)(int, int, int, int, void*, void*) = fg->modulo ? bufferRowPeriodic : bufferRow;
+    
+    unsigned start, end;
+    ThreadPool::partition(fg->paintList.size(), rank, nbt, start, end);
+    
+    for ( unsigned i = start; i < end; ++i )
+    {
+        Fiber const* fib = fg->paintList[i];
+        paintFiber(paint, &buf, fib, fg->mGrid, fg->paintWidth);
+        buf.cnt += fib->nbSegments();
+    }
+}
+
+
+/**
+ The Fibers are divided in contiguous ranges, which are rasterized by different threads.
+ The cells covered by the segments are recorded in paintBuffers, without modifying the grid.
+ Reading the buffers in the order of the threads, and the rows of each buffer in order,
+ gives the same sequence as a serial paint, and the lists of segments obtained
+ by merging the buffers are thus independent of the number of threads.
+ */
+void FiberGrid::paintParallel(const Fiber * first, const Fiber * last, const real width)
+{
+    paintList.clear();
+    for ( const Fiber * fib = first; fib != last ; fib=fib->next() )
+        paintList.push_back(fib);
+    
+    paintWidth = width;
+    paintBuffers.resize(POOL.size());
+    for ( unsigned t = 0; t < paintBuffers.size(); ++t )
+    {
+        paintBuffers[t].grid = &mGrid;
+        paintBuffers[t].rows.clear();
+        paintBuffers[t].cnt = 0;
+    }
+    
+    POOL.run(paintJob, this);
+    
+    nbPainted = 0;
+    for ( unsigned t = 0; t < paintBuffers.size(); ++t )
+        nbPainted += paintBuffers[t].cnt;
+}
+
+//------------------------------------------------------------------------------
+/**
+paintGrid( first_fiber, last_fiber, max_range ) links all segments found in 'fiber' and its
+ descendant, in the point-list GP that match distance(GP, segment) < H.
+ 
+ 'H' is calculated such that tryToAttach() finds any segment closer than 'max_range':
+ 
+ To determine H, we start from a relation on the sides of a triangle:
+ (A) distance( GP, segment ) < distance( GP, X ) + distance( X, segment )
+ where GP (grid-point) is the closest point on the grid to X.
+ 
+ Since GP in tryToAttach() is the closest point on mGrid to X, we have:
+ (B) distance( GP, X ) < 0.5 * mGrid.diagonalLength()
+ 
+ Thus to find all rods for which:
+ (B) distance( X, segment ) < max_range
+ we simply use:
+ H =  max_range + 0.5 * mGrid.diagonalLength();
+ 
+ Note: H is calculated by paintGrid(), and the user only provides 'max_range'.
+ 
+ Linking all segments is done in an inverse way:
+ for each segment, we cover all points of the grid inside a volume obtained
+ by inflating the segment by the length H. We use for that the raterizer which
+ calls the function paint() above.
+ 
+ If simul:threads > 1, the segments are rasterized in parallel by paintParallel(),
+ and the grid is then filled by a single thread, giving the same lists as a serial paint.
+ */
+
+void FiberGrid::paintGrid(const Fiber * first, const Fiber * last, const real max_range)
+{
+    assert_true(hasGrid());
+    ++paintCount;
+    
+#if FIBER_GRID_COMPACT
+    if ( gridSkin > 0 )
+        throw InvalidParameter("simul:binding_grid_skin cannot be used with FIBER_GRID_COMPACT");
+
+    gridRange = max_range;
+    real width = gridRange + 0.5 * mGrid.diagonalLength();
+    
+    // count the segments in each cell:
+    clearUsedCells();
+    if ( POOL.size() > 1 )
+    {
+        paintParallel(first, last, width);
+        for ( unsigned t = 0; t < paintBuffers.size(); ++t )
+        {
+            PaintedRow const* rows = paintBuffers[t].rows.begin();
+            PaintedRow const* end = paintBuffers[t].rows.end();
+            for ( PaintedRow const* r = rows; r < end; ++r )
+            {
+                SegmentRange * inf = &mGrid.cell(r->inf);
+                for ( SegmentRange * cell = inf; cell <= inf + ( r->sup - r->inf ); ++cell )
+                    countSegment(cell);
+            }
+        }
+    }
+    else
+        paintFibers(modulo ? countCellPeriodic : countCell, this, first, last, width);
+    
+    // set the ranges of the non-empty cells, and allocate the array of segments:
+    unsigned sum = 0;
+    for ( unsigned u = 0; u < usedCells.size(); ++u )
+    {
+        SegmentRange & cell = mGrid.cell(usedCells[u]);
+        cell.start = sum;
+        sum += cell.cnt;
+        cell.cnt = 0;
+    }
+    
+    if ( sum > cellSegsMax )
+    {
+        delete[] cellSegs;
+        cellSegsMax = sum + sum / 4;
+        cellSegs = new FiberLocus const*[cellSegsMax];
+    }
+    
+    // fill the cells:
+    if ( POOL.size() > 1 )
+    {
+        for ( unsigned t = 0; t < paintBuffers.size(); ++t )
+        {
+            PaintedRow const* rows = paintBuffers[t].rows.begin();
+            PaintedRow const* end = paintBuffers[t].rows.end();
+            for ( PaintedRow const* r = rows; r < end; ++r )
+            {
+                SegmentRange * inf = &mGrid.cell(r->inf);
+                for ( SegmentRange * cell = inf; cell <= inf + ( r->sup - r->inf ); ++cell )
+                    cellSegs[cell->start+cell->cnt++] = r->seg;
+            }
+        }
+    }
+    else
+        paintFibers(modulo ? fillCellPeriodic : fillCell, this, first, last, width);
+#else
+    if ( gridSkin > 0 )
+    {
+        repaintGrid(first, last, max_range);
+        nbPaintedTotal += nbPainted;
+        return;
+    }
+
+    clear();
+    gridRange = max_range;
+    real width = gridRange + 0.5 * mGrid.diagonalLength();
+    
+    if ( POOL.size() > 1 )
+    {
+        paintParallel(first, last, width);
+        // merge the buffers in order:
+        for ( unsigned t = 0; t < paintBuffers.size(); ++t )
+        {
+            PaintedRow const* rows = paintBuffers[t].rows.begin();
+            PaintedRow const* end = paintBuffers[t].rows.end();
+            for ( PaintedRow const* r = rows; r < end; ++r )
+            {
+                SegmentList * inf = &mGrid.cell(r->inf);
+                for ( SegmentList * list = inf; list <= inf + ( r->sup - r->inf ); ++list )
+                    list->push_back(r->seg);
+            }
+        }
+    }
+    else
+        paintFibers(modulo ? paintCellPeriodic : paintCell, &mGrid, first, last, width);
+#endif
+    
+    nbSegments = nbPainted;
+    nbPaintedTotal += nbPainted;
+}
+
+
+#if !FIBER_GRID_COMPACT
+
+/**
+ Incremental version of paintGrid(), used if gridSkin > 0.
+ The segments are painted with a width extended by gridSkin, using the positions
+ of the vertices recorded in Record::pos, which are updated only for the vertices
+ that have moved by more than gridSkin. Hence all the segments remain covered
+ within the requested range, as long as the segments are straight.
+ 
+ All the segments are erased before any is painted, since the address of a segment
+ of a deleted Fiber may have been reused by another Fiber.
+ */
+void FiberGrid::repaintGrid(const Fiber * first, const Fiber * last, const real max_range)
+{
+    real width = max_range + gridSkin + 0.5 * mGrid.diagonalLength();
+    
+    // everything must be repainted if the range has changed:
+    if ( max_range != gridRange  ||  width != gridWidth )
+        clear();
+    
+    gridRange = max_range;
+    gridWidth = width;
+    nbPainted = 0;
+    nbSegments = 0;
+    
+    const real skin_sqr = gridSkin * gridSkin;
+    void (*erase)(int, int, int, int, void*, void*) = modulo ? eraseCellPeriodic : eraseCell;
+    
+    // erase the segments that have moved, and those of modified Fibers:
+    for ( const Fiber * fib = first; fib != last ; fib=fib->next() )
+    {
+        Record & rec = records[fib->number()];
+        rec.mark = paintCount;
+        
+        const unsigned nbp = fib->nbPoints();
+        FiberLocus const* seg = nbp > 1 ? &(fib->segment(0)) : 0;
+        
+        if ( rec.fib != fib  ||  rec.seg != seg  ||  rec.pos.size() != nbp )
+        {
+            eraseFiber(rec);
+            rec.fib = fib;
+            rec.seg = seg;
+            rec.pos.resize(nbp);
+            rec.dirty.assign(nbp, true);
+            for ( unsigned p = 0; p < nbp; ++p )
+                rec.pos[p] = fib->posPoint(p);
+        }
+        else
+        {
+            for ( unsigned p = 0; p < nbp; ++p )
+                rec.dirty[p] = ( fib->posPoint(p) - rec.pos[p] ).normSqr() > skin_sqr;
+            // segment 'p' is dirty if one of its ends has moved:
+            for ( unsigned p = 0; p+1 < nbp; ++p )
+                rec.dirty[p] = rec.dirty[p] || rec.dirty[p+1];
+            // erase with the old positions, and then update the positions:
+            for ( unsigned p = 0; p+1 < nbp; ++p )
+            {
+                if ( rec.dirty[p] )
+                    rasterize(erase, &mGrid, seg+p, mGrid, rec.pos[p], rec.pos[p+1], gridWidth, 0);
+            }
+            for ( unsigned p = 0; p < nbp; ++p )
+            {
+                if ( ( fib->posPoint(p) - rec.pos[p] ).normSqr() > skin_sqr )
+                    rec.pos[p] = fib->posPoint(p);
+            }
+        }
+    }
+    
+    // erase the Fibers that were not seen:
+    record_map::iterator it = records.begin();
+    while ( it != records.end() )
+    {
+        if ( it->second.mark != paintCount )
+        {
+            eraseFiber(it->second);
+            records.erase(it++);
+        }
+        else
+            ++it;
+    }
+    
+    void (*paint)(int, int, int, int, void*, void*) = modulo ? paintCellPeriodic : paintCell;
+    
+    // paint the segments that were erased, at the recorded positions:
+    for ( const Fiber * fib = first; fib != last ; fib=fib->next() )
+    {
+        Record & rec = records[fib->number()];
+        const unsigned nbs = fib->nbSegments();
+        
+        for ( unsigned p = 0; p < nbs; ++p )
+        {
+            if ( rec.dirty[p] )
+            {
+                rasterize(paint, &mGrid, rec.seg+p, mGrid, rec.pos[p], rec.pos[p+1], gridWidth, 0);
+                ++nbPainted;
+            }
+        }
+        nbSegments += nbs;
+    }
+}
+
+
+/**
+ Remove all the segments of the Fiber from the grid, using the recorded positions
+ */
+void FiberGrid::eraseFiber(Record const& rec)
+{
+    void (*erase)(int, int, int, int, void*, void*) = modulo ? eraseCellPeriodic : eraseCell;
+    
+    for ( unsigned p = 1; p < rec.pos.size(); ++p )
+        rasterize(erase, &mGrid, rec.seg+p-1, mGrid, rec.pos[p-1], rec.pos[p], gridWidth, 0);
+}
+
+
+#endif
+
+//============================================================================
+#pragma mark -
+
+/**
+ Randomly permutes the segments in [beg, end[, in the same way as Array::mix()
+ */
+void mixSegments(FiberLocus const** beg, FiberLocus const** end, Random& rng)
+{
+    unsigned jj = end - beg, kk;
+    while ( jj > 1 )
+    {
+        kk = rng.pint() % jj;  //between 0 and j-1
+        --jj;
+        FiberLocus const* tmp = beg[jj];
+        beg[jj] = beg[kk];
+        beg[kk] = tmp;
+    }
+}
+
+
+/**
+ Attach the Hand to the first segment of [beg, end[ that is within its binding range,
+ and on which the attachment is allowed.
+ */
+static bool attachFirst(FiberLocus const** beg, FiberLocus const** end, Vector const& place, Hand& ha)
+{
+    for ( FiberLocus const** si = beg; si < end; ++si )
+    {
+        FiberLocus const* loc = *si;
+        
+        real abs, dis = INFINITY;
+        // Compute the distance from the hand to the rod:
+        loc->projectPoint(place, abs, dis);      // always works
+        //loc->projectPointF(place, abs, dis);    // faster, but not compatible with periodic boundaries
+        
+        // compare to the maximum attach distance of the hand:
+        if ( dis > ha.prop->binding_range_sqr )
+            continue;
+        
+        Fiber * fib = const_cast<Fiber*>(loc->fiber());
+        
+        FiberBinder site(fib, fib->abscissaP(loc->point())+abs);
+        
+        if ( ha.attachmentAllowed(site) )
+        {
+            ha.attach(site);
+            return true;
+        }
+    }
+    return false;
+}
+
+
+/**
+ The range at which Hand will the the Fibers is limited to the range given in paintGrid()
+
+ In concurrent mode, the list of the cell is copied before it is mixed, 
+ such that the grid is not modified.
+ */
+bool FiberGrid::tryToAttach(Vector const& place, Hand& ha) const
+{
+    assert_true( hasGrid() );
+    
+    if ( gridRange < ha.prop->binding_range )
+    {
+        printf("Warning: the FiberGrid range was exceeded:\n");
+        //printf("  gridRange = %.3e < Hand::binding_range = %.3f\n", gridRange, ha.prop->binding_range);
+        //throw InvalidParameter("the FiberGrid range was exceeded");
+    }
+    
+    //get the grid node list index closest to the position in space:
+    const unsigned int indx = mGrid.index(place, 0.5);
+    
+    //get the list of rods associated with this cell:
+    FiberLocus const** end;
+    FiberLocus const** beg = cellSegments(indx, end);
+    
+    if ( concurrent )
+    {
+        const unsigned cnt = end - beg;
+        FiberLocus const* tmp[32];
+        FiberLocus const** cpy = tmp;
+        if ( cnt > 32 )
+            cpy = new FiberLocus const*[cnt];
+        for ( unsigned i = 0; i < cnt; ++i )
+            cpy[i] = beg[i];
+        mixSegments(cpy, cpy+cnt, RNG);
+        bool res = attachFirst(cpy, cpy+cnt, place, ha);
+        if ( cpy != tmp )
+            delete[] cpy;
+        return res;
+    }
+   
+    //randomize the list, to make attachments more fair:
+    //this might not be necessary, since the MT list is already mixed
+    mixSegments(beg, end, RNG);
+    
+    return attachFirst(beg, end, place, ha);
+}
+
+
+//------------------------------------------------------------------------------
+#pragma mark -
+
+/**
+ In batch mode, the Hand is recorded with the cell containing `pos`, and it will
+ be attached by attachPending(). Otherwise tryToAttach() is called immediately.
+ Batch mode is not used in concurrent mode, since `requests` is shared.
+ */
+void FiberGrid::requestAttach(Vector const& place, Hand& ha) const
+{
+    if ( batchMode  &&  !concurrent )
+    {
+        Request req;
+        req.hand  = &ha;
+        req.pos   = place;
+        req.cell  = mGrid.index(place, 0.5);
+        req.order = requests.size();
+        requests.push_back(req);
+    }
+    else
+    {
+        tryToAttach(place, ha);
+    }
+}
+
+
+/// order the Requests by cell, and in the order in which they were made
+int FiberGrid::compareRequests(const void * a, const void * b)
+{
+    Request const* ra = static_cast<Request const*>(a);
+    Request const* rb = static_cast<Request const*>(b);
+    if ( ra->cell != rb->cell )
+        return ( ra->cell < rb->cell ) ? -1 : 1;
+    return ( ra->order < rb->order ) ? -1 : ( ra->order > rb->order );
+}
+
+
+/**
+ The requests are sorted by cell, such that the segments of each cell
+ are loaded only once, for all the Hands located in this cell.
+ */
+void FiberGrid::attachPending()
+{
+    if ( requests.empty() )
+        return;
+    
+    qsort(&requests[0], requests.size(), sizeof(Request), compareRequests);
+    
+    unsigned start = 0;
+    while ( start < requests.size() )
+    {
+        unsigned stop = start + 1;
+        while ( stop < requests.size()  &&  requests[stop].cell == requests[start].cell )
+            ++stop;
+        attachCell(start, stop);
+        start = stop;
+    }
+    
+    requests.clear();
+}
+
+
+#if ( DIM == 2 ) && defined(__SSE3__) && !defined(REAL_IS_FLOAT)
+#include <pmmintrin.h>
+
+/**
+ Calculate the projection of `w` on the `n` segments stored in `buf`, two segments at a time.
+ The projection is correct only for the segments where 0 <= abs <= len.
+ `buf` should contain the coordinates ( X, Y, dX, dY, len ) of `m` segments, with `m` even and m >= n
+ */
+void projectSegments(real const* buf, unsigned n, unsigned m, Vector const& w, real* abs, real* dis)
+{
+    real const* px = buf;
+    real const* py = buf + m;
+    real const* dx = buf + 2*m;
+    real const* dy = buf + 3*m;
+    real const* ls = buf + 4*m;
+    
+    __m128d wx = _mm_set1_pd(w.XX);
+    __m128d wy = _mm_set1_pd(w.YY);
+    
+    for ( unsigned i = 0; i < n; i += 2 )
+    {
+        __m128d ax = _mm_sub_pd(wx, _mm_load_pd(px+i));
+        __m128d ay = _mm_sub_pd(wy, _mm_load_pd(py+i));
+        __m128d s = _mm_add_pd(_mm_mul_pd(ax, _mm_load_pd(dx+i)), _mm_mul_pd(ay, _mm_load_pd(dy+i)));
+        __m128d a = _mm_div_pd(s, _mm_load_pd(ls+i));
+        __m128d d = _mm_sub_pd(_mm_add_pd(_mm_mul_pd(ax, ax), _mm_mul_pd(ay, ay)), _mm_mul_pd(a, a));
+        _mm_store_pd(abs+i, a);
+        _mm_store_pd(dis+i, d);
+    }
+}
+
+#else
+
+/**
+ Calculate the projection of `w` on the `n` segments stored in `buf`.
+ The projection is correct only for the segments where 0 <= abs <= len.
+ `buf` should contain the coordinates ( X, Y, Z, dX, dY, dZ, len ) of `m` segments, with m >= n
+ */
+void projectSegments(real const* buf, unsigned n, unsigned m, Vector const& w, real* abs, real* dis)
+{
+    for ( unsigned i = 0; i < n; ++i )
+    {
+        real s = 0, nn = 0;
+        for ( int d = 0; d < DIM; ++d )
+        {
+            real a = w[d] - buf[d*m+i];
+            s  += a * buf[(DIM+d)*m+i];
+            nn += a * a;
+        }
+        abs[i] = s / buf[2*DIM*m+i];
+#if ( DIM == 1 )
+        dis[i] = 0;
+#else
+        dis[i] = nn - abs[i] * abs[i];
+#endif
+    }
+}
+
+#endif
+
+
+/**
+ This is equivalent to calling tryToAttach() for each Hand in requests[start, stop[,
+ but the coordinates of the segments of the cell are loaded once, and the distances
+ to all segments are calculated together for each Hand.
+ 
+ Instead of mixing the list of segments, a random segment is picked among those within
+ range, until attachment succeeds. The probability of binding to each segment is
+ thus the same as in tryToAttach().
+ */
+void FiberGrid::attachCell(const unsigned start, const unsigned stop)
+{
+    FiberLocus const** end;
+    FiberLocus const** beg = cellSegments(requests[start].cell, end);
+    
+    const unsigned n = end - beg;
+    if ( n == 0 )
+        return;
+    
+    // load the coordinates of the segments, with padding to an even size:
+    const unsigned m = n + ( n & 1 );
+    segData.resize(( 2*DIM + 1 ) * m + 1);
+    segDist.resize(m+1);
+    segAbs.resize(m+1);
+    segHits.resize(n);
+    
+    // align the buffer for SIMD load instructions:
+    real * buf = &segData[0];
+    if ( reinterpret_cast<unsigned long>(buf) & 15 )
+        ++buf;
+    real * dis = &segDist[0];
+    if ( reinterpret_cast<unsigned long>(dis) & 15 )
+        ++dis;
+    real * abs = &segAbs[0];
+    if ( reinterpret_cast<unsigned long>(abs) & 15 )
+        ++abs;
+    
+    for ( unsigned i = 0; i < m; ++i )
+    {
+        FiberLocus const* loc = beg[ i < n ? i : 0 ];
+        Vector P = loc->pos1(), D = loc->diff();
+        for ( int d = 0; d < DIM; ++d )
+        {
+            buf[d*m+i] = P[d];
+            buf[(DIM+d)*m+i] = D[d];
+        }
+        buf[2*DIM*m+i] = loc->len();
+    }
+    
+    for ( unsigned r = start; r < stop; ++r )
+    {
+        Hand & ha = *requests[r].hand;
+        Vector const& place = requests[r].pos;
+        
+        if ( ha.attached() )
+            continue;
+        
+        if ( gridRange < ha.prop->binding_range )
+            printf("Warning: the FiberGrid range was exceeded:\n");
+        
+        const real range_sqr = ha.prop->binding_range_sqr;
+        
+        if ( modulo )
+        {
+            for ( unsigned i = 0; i < n; ++i )
+            {
+                dis[i] = INFINITY;
+                beg[i]->projectPoint(place, abs[i], dis[i]);
+            }
+        }
+        else
+        {
+            projectSegments(buf, n, m, place, abs, dis);
+            // correct the projections that fall outside the segments:
+            for ( unsigned i = 0; i < n; ++i )
+            {
+                if ( abs[i] < 0 )
+                    dis[i] = beg[i]->isFirst() ? place.distanceSqr(beg[i]->pos1()) : INFINITY;
+                else if ( abs[i] > buf[2*DIM*m+i] )
+                    dis[i] = beg[i]->isLast() ? place.distanceSqr(beg[i]->pos2()) : INFINITY;
+            }
+        }
+        
+        // collect the segments within range:
+        unsigned nh = 0;
+        for ( unsigned i = 0; i < n; ++i )
+        {
+            if ( dis[i] <= range_sqr )
+                segHits[nh++] = i;
+        }
+        
+        // try the segments in random order:
+        while ( nh > 0 )
+        {
+            unsigned k = RNG.pint() % nh;
+            unsigned i = segHits[k];
+            
+            FiberLocus const* loc = beg[i];
+            Fiber * fib = const_cast<Fiber*>(loc->fiber());
+            FiberBinder site(fib, fib->abscissaP(loc->point())+abs[i]);
+            
+            if ( ha.attachmentAllowed(site) )
+            {
+                ha.attach(site);
+                break;
+            }
+            segHits[k] = segHits[--nh];
+        }
+    }
+}
+
+
+//------------------------------------------------------------------------------
+#pragma mark - Queries
+
+/**
+ This is similar to FiberLocus::projectPoint(), but the distance to the ends
+ of the Fiber is also calculated with periodic boundary conditions.
+ `dis` is the squared distance, and `pos` is set to the point of the segment that is
+ closest to `w`, in the same periodic image as the segment.
+ @returns false if `w` projects outside the segment, on a side that is covered by
+ the neighboring segment of the same Fiber.
+ */
+bool FiberGrid::projectSegment(FiberLocus const& loc, Vector const& w, real& abs, real& dis, Vector& pos) const
+{
+    Vector dx = loc.diff();
+    Vector aw = w - loc.pos1();
+    
+    if ( modulo )
+        modulo->fold(aw);
+    
+    const real ls = loc.len();
+    abs = ( aw * dx ) / ls;
+    
+    if ( abs < 0 )
+    {
+        if ( !loc.isFirst() )
+            return false;
+        abs = 0;
+    }
+    else if ( abs > ls )
+    {
+        if ( !loc.isLast() )
+            return false;
+        abs = ls;
+    }
+    
+    Vector p = dx * ( abs / ls );
+    dis = ( aw - p ).normSqr();
+    pos = loc.pos1() + p;
+    return true;
+}
+
+
+/**
+ Call `func` for each segment of cell `indx` that is within distance sqrt(DD) of `w`.
+ If `unique` is true, only the segments for which the closest point to `w` is located
+ in cell `indx` are considered. Since a segment is always listed in the cell containing
+ any of its points, this selects each segment in exactly one cell.
+ */
+unsigned FiberGrid::visitCell(const unsigned indx, Vector const& w, const real DD, const bool unique,
+                              SegmentVisitor func, void* arg) const
+{
+    unsigned res = 0;
+    FiberLocus const** end;
+    FiberLocus const** beg = cellSegments(indx, end);
+    
+    for ( FiberLocus const** si = beg; si < end; ++si )
+    {
+        real abs, dis;
+        Vector pos;
+        if ( projectSegment(**si, w, abs, dis, pos)  &&  dis <= DD )
+        {
+            if ( !unique  ||  mGrid.index(pos, 0.5) == indx )
+            {
+                func(**si, abs, dis, arg);
+                ++res;
+            }
+        }
+    }
+    return res;
+}
+
+
+/**
+ Call `func(seg, abs, dis, arg)` for every segment located at distance D or less from P,
+ where `abs` is the abscissa of the projection of P from the start of the segment,
+ and `dis` is the squared distance. Each segment is reported once, without allocating memory.
+ With periodic boundary conditions, the distance to the closest image is used.
+ 
+ If D is within the range given to paintGrid(), only the cell containing P is visited.
+ Otherwise, all the cells within distance D of P are visited, and a segment is
+ reported only by the cell containing its closest point to P.
+ */
+unsigned FiberGrid::forEachSegment(Vector const& P, const real D, SegmentVisitor func, void* arg) const
+{
+    if ( gridRange <= 0 )
+        throw InvalidParameter("the Grid was not initialized");
+    
+    const real DD = D * D;
+    
+    if ( D <= gridRange )
+        return visitCell(mGrid.index(P, 0.5), P, DD, false, func, arg);
+    
+    // range of cell coordinates covering [ P-D, P+D ] in each dimension:
+    int inf[3] = { 0 }, sup[3] = { 0 }, c[3] = { 0 };
+    for ( int d = 0; d < DIM; ++d )
+    {
+        const int dim = mGrid.dim(d);
+        inf[d] = (int)floor(0.5 + ( P[d] - D - mGrid.inf(d) ) * mGrid.delta(d));
+        sup[d] = (int)floor(0.5 + ( P[d] + D - mGrid.inf(d) ) * mGrid.delta(d));
+        if ( modulo  &&  modulo->isPeriodic(d) )
+        {
+            // visit each cell only once:
+            if ( sup[d] - inf[d] >= dim )
+            {
+                inf[d] = 0;
+                sup[d] = dim - 1;
+            }
+        }
+        else
+        {
+            inf[d] = std::max(inf[d], 0);
+            sup[d] = std::min(sup[d], dim - 1);
+        }
+        c[d] = inf[d];
+    }
+    
+    unsigned res = 0;
+    while ( 1 )
+    {
+        res += visitCell(mGrid.indexFromCoordinates(c), P, DD, true, func, arg);
+        
+        // increment the coordinates:
+        int d = 0;
+        while ( d < DIM  &&  ++c[d] > sup[d] )
+        {
+            c[d] = inf[d];
+            ++d;
+        }
+        if ( d == DIM )
+            break;
+    }
+    return res;
+}
+
+
+/// the results of nearestSegments()
+struct NearestSegments
+{
+    unsigned           max;  ///< maximum number of segments
+    unsigned           cnt;  ///< number of segments found
+    FiberLocus const** seg;  ///< the segments, by increasing distance
+    real             * dis;  ///< squared distances of the segments
+};
+
+
+/// insert segment in the sorted list of NearestSegments, if it is close enough
+static void insertNearest(FiberLocus const& loc, real, real dis, void* arg)
+{
+    NearestSegments * ns = static_cast<NearestSegments*>(arg);
+    
+    unsigned i = ns->cnt;
+    if ( i == ns->max )
+    {
+        if ( dis >= ns->dis[i-1] )
+            return;
+        --i;
+    }
+    else
+        ++ns->cnt;
+    
+    while ( i > 0  &&  ns->dis[i-1] > dis )
+    {
+        ns->seg[i] = ns->seg[i-1];
+        ns->dis[i] = ns->dis[i-1];
+        --i;
+    }
+    ns->seg[i] = &loc;
+    ns->dis[i] = dis;
+}
+
+
+/**
+ Find the `cnt` segments that are closest to P, within distance D.
+ The segments are stored in `seg[]` by order of increasing distance,
+ with their squared distances in `dis[]`. Both arrays must have size `cnt` at least.
+ @returns the number of segments found, which can be less than `cnt`
+ */
+unsigned FiberGrid::nearestSegments(Vector const& P, real D, unsigned cnt, FiberLocus const* seg[], real dis[]) const
+{
+    if ( cnt == 0 )
+        return 0;
+    
+    NearestSegments ns;
+    ns.max = cnt;
+    ns.cnt = 0;
+    ns.seg = seg;
+    ns.dis = dis;
+    
+    forEachSegment(P, D, insertNearest, &ns);
+    return ns.cnt;
+}
+
+
+/// the arguments of nearbySegments()
+struct NearbySegments
+{
+    FiberGrid::SegmentList * list;
+    Fiber const* exclude;
+};
+
+
+/// add segment to the list, unless it belongs to the excluded Fiber
+static void addNearby(FiberLocus const& loc, real, real, void* arg)
+{
+    NearbySegments * ns = static_cast<NearbySegments*>(arg);
+    if ( loc.fiber() != ns->exclude )
+        ns->list->push_back(&loc);
+}
+
+
+/** 
+ This calls forEachSegment(), and the distance D is thus not limited.
+ */
+FiberGrid::SegmentList FiberGrid::nearbySegments( Vector const& place, const real D, Fiber * exclude)
+{
+    SegmentList res;
+    NearbySegments ns;
+    ns.list = &res;
+    ns.exclude = exclude;
+    forEachSegment(place, D, addNearby, &ns);
+    return res;
+}
+
+
+//============================================================================
+//===                            ACCESSORY                                ====
+//============================================================================
+
+FiberLocus FiberGrid::closestSegment(Vector const& place)
+{
+    //get the cell index from the position in space:
+    const unsigned indx = mGrid.index( place, 0.5 );
+    
+    //get the list of rods associated with this cell:
+    FiberLocus const** end;
+    FiberLocus const** beg = cellSegments(indx, end);
+    
+    FiberLocus const* res = 0;
+    real closest = 4 * gridRange * gridRange;
+    
+    for ( FiberLocus const** si = beg; si < end; ++si )
+    {
+        FiberLocus const* loc = *si;
+        
+        //we compute the distance from the hand to the candidate rod,
+        //and compare it to the best we have so far.
+        real abs, dis = INFINITY;
+        loc->projectPoint(place, abs, dis);
+        
+        if ( dis < closest )
+        {
+            closest = dis;
+            res = loc;
+        }
+    }
+    return *res;
+}
+
+
+#endif
+
+
+//============================================================================
+//===                       DEBUG  ATTACHMENT                             ====
+//============================================================================
+#pragma mark -
+
+#include <map>
+#include "simul.h"
+
+/**
+Function testAttach() is given a position in space,
+ it calls tryToAttach() from this position to check that:
+ - attachement has equal probability to all targets,
+ - no target is missed,
+ - attachment are not made to targets that are beyond binding_range_max
+ */
+void FiberGrid::testAttach(FILE * out, const Vector pos, Fiber * start, HandProp const* hp)
+{
+    //create a test motor with a dummy HandMonitor:
+    HandMonitor hm;
+    Hand ha(hp, &hm);
+    real dsq = hp->binding_range_sqr;
+    
+    typedef std::map < FiberLocus const*, int > map_type;
+    map_type hits;
+    
+    //go through all the segments to find those close enough from pos:
     for ( Fiber * fib=start; fib; fib=fib->next() )
     {
         for ( unsigned int p = 0; p < fib->nbSegments(); ++p )
@@ -476,3 +1494,159 @@ void FiberGrid::testAttach(FILE * out, const Vector pos, Fiber * start, HandProp
     }
 }
 
+
+
+/**
+ Squared distance from `w` to the segment `loc`, with the criterion used by nearbySegments()
+ before forEachSegment() was introduced: a projection that falls outside the segment
+ only counts at the ends of the Fiber.
+ @returns INFINITY if `w` projects outside, on a side covered by another segment
+ */
+static real referenceDistance(FiberLocus const& loc, Vector const& w, Modulo const* modulo)
+{
+    Vector dx = loc.diff();
+    Vector aw = w - loc.pos1();
+    
+    if ( modulo )
+        modulo->fold(aw);
+    
+    const real ls = loc.len();
+    const real abs = ( aw * dx ) / ls;
+    
+    if ( abs < 0 )
+        return loc.isFirst() ? aw.normSqr() : INFINITY;
+    if ( abs > ls )
+        return loc.isLast() ? ( aw - dx ).normSqr() : INFINITY;
+    return ( aw - dx * ( abs / ls ) ).normSqr();
+}
+
+
+/**
+ Function testNearby() compares, at a given position and distance D:
+ - nearbySegments(),
+ - the previous implementation of nearbySegments(), which scanned the cell containing `pos`,
+   if D is within the range given to paintGrid(),
+ - a search through all the segments of all Fibers,
+ - nearestSegments() and the closest segments found by the search.
+ .
+ Segments located at D, within rounding errors, may be found by one method and not the other.
+ A summary is printed if any other difference is found.
+ @returns the number of differences found
+ */
+unsigned FiberGrid::testNearby(FILE * out, const Vector pos, const real D, Fiber * start)
+{
+    const real DD = D * D;
+    const real tol = 1e-6 * DD;
+    
+    typedef std::map < FiberLocus const*, real > map_type;
+    map_type all, old;
+    
+    //go through all the segments to find those close enough from pos:
+    for ( Fiber * fib=start; fib; fib=fib->next() )
+    {
+        for ( unsigned int p = 0; p < fib->nbSegments(); ++p )
+        {
+            FiberLocus const& loc = fib->segment(p);
+            real dis = referenceDistance(loc, pos, modulo);
+            if ( dis <= DD + tol )
+                all[&loc] = dis;
+        }
+    }
+    
+    //the previous implementation, limited to the range of the grid:
+    if ( D <= gridRange )
+    {
+        FiberLocus const** end;
+        FiberLocus const** beg = cellSegments(mGrid.index(pos, 0.5), end);
+        for ( FiberLocus const** si = beg; si < end; ++si )
+        {
+            real dis = referenceDistance(**si, pos, modulo);
+            if ( dis <= DD + tol )
+                old[*si] = dis;
+        }
+    }
+    
+    SegmentList res = nearbySegments(pos, D, 0);
+    
+    unsigned err = 0;
+    
+    //every segment returned should be within reach, and listed only once:
+    for ( unsigned n = 0; n < res.size(); ++n )
+    {
+        map_type::const_iterator it = all.find(res[n]);
+        if ( it == all.end() )
+        {
+            fprintf(out, "   segment returned by nearbySegments() is out of range\n");
+            ++err;
+        }
+        for ( unsigned m = 0; m < n; ++m )
+            if ( res[m] == res[n] )
+            {
+                fprintf(out, "   segment returned twice by nearbySegments()\n");
+                ++err;
+            }
+    }
+    
+    //every segment within reach should be returned:
+    for ( map_type::const_iterator it = all.begin(); it != all.end(); ++it )
+    {
+        if ( res.find(it->first) < 0  &&  it->second < DD - tol )
+        {
+            fprintf(out, "   segment at distance %.6f missed by nearbySegments()\n", sqrt(it->second));
+            ++err;
+        }
+        if ( D <= gridRange  &&  old.find(it->first) == old.end()  &&  it->second < DD - tol )
+        {
+            fprintf(out, "   segment at distance %.6f missed by the previous implementation\n", sqrt(it->second));
+            ++err;
+        }
+    }
+    
+    //the previous implementation should not find more segments:
+    for ( map_type::const_iterator it = old.begin(); it != old.end(); ++it )
+    {
+        if ( res.find(it->first) < 0  &&  it->second < DD - tol )
+        {
+            fprintf(out, "   segment found by the previous implementation, but not by nearbySegments()\n");
+            ++err;
+        }
+    }
+    
+    //the nearest segments should have the smallest distances:
+    const unsigned CNT = 4;
+    FiberLocus const* seg[CNT];
+    real dis[CNT];
+    unsigned cnt = nearestSegments(pos, D, CNT, seg, dis);
+    //count the segments within reach, and those closer than the last one found:
+    unsigned nb_near = 0, nb_closer = 0;
+    for ( map_type::const_iterator it = all.begin(); it != all.end(); ++it )
+    {
+        if ( it->second < DD - tol )
+        {
+            ++nb_near;
+            if ( cnt > 0  &&  it->second < dis[cnt-1] - tol )
+                ++nb_closer;
+        }
+    }
+    if ( cnt < std::min(CNT, nb_near)  ||  ( cnt > 0  &&  nb_closer >= cnt ) )
+    {
+        fprintf(out, "   nearestSegments() found %u segments, with %u closer segments\n", cnt, nb_closer);
+        ++err;
+    }
+    for ( unsigned n = 1; n < cnt; ++n )
+    {
+        if ( dis[n] < dis[n-1] )
+        {
+            fprintf(out, "   nearestSegments() are not ordered\n");
+            ++err;
+        }
+    }
+
+    if ( err )
+    {
+        fprintf(out, "testNearby found %u error(s)\n", err);
+        fprintf(out, "   %lu segments within %.3f um, %u returned, range of grid %.3f um\n",
+                all.size(), D, res.size(), gridRange);
+    }
+    return err;
+}
@@ -7,7 +7,9 @@
 #include "vector.h"
 #include "array.h"
 #include "grid.h"
+#include "grid_sparse.h"
 #include <vector>
+#include <map>
 
 class FiberLocus;
 class Space;
@@ -19,6 +21,38 @@ class Node;
 class Simul;
 
 
+///\def FIBER_GRID_COMPACT selects the storage of the segments in FiberGrid
+/**
+ If FIBER_GRID_COMPACT is 0, each cell of the grid holds its own Array of segments,
+ which is extended by push_back() while the segments are painted.
+ 
+ If FIBER_GRID_COMPACT is 1, the segments of all cells are stored in a single array,
+ and each cell only holds the range of this array that corresponds to it.
+ The segments are then painted twice, to first count the segments of each cell,
+ and then to fill the array. This avoids allocating memory in each cell,
+ and the lists read by tryToAttach() are contiguous in memory.
+ The cells that received segments are recorded, and only these are reset
+ before the next paint.
+ This is experimental: it does not support simul:binding_grid_skin,
+ and SimulProp::complete() rejects a config that sets a skin.
+ */
+#define FIBER_GRID_COMPACT 0
+
+
+///\def FIBER_GRID_SPARSE selects a grid that allocates the cells only where segments are painted
+/**
+ If FIBER_GRID_SPARSE is 1, the cells are allocated by rows when they are first painted (see GridSparse).
+ The limit on the number of cells given to setGrid() then applies to the number of rows,
+ such that a fine grid can be used to cover a large Space, which is mostly empty.
+ This can only be used with FIBER_GRID_COMPACT = 0.
+ */
+#define FIBER_GRID_SPARSE 0
+
+#if FIBER_GRID_SPARSE && FIBER_GRID_COMPACT
+#  error "FIBER_GRID_SPARSE requires FIBER_GRID_COMPACT = 0"
+#endif
+
+
 /// Divide-and-Conquer method to find all FiberLocus located near a given point in space
 /**
 A divide-and-conquer algorithm is used to find all segments of fibers close to a given point:
@@ -37,12 +71,17 @@ A divide-and-conquer algorithm is used to find all segments of fibers close to a
     Finally, using a random number it tests the probability of attachment for the Hand given as argument.
  .
  
- @todo we could call paintGrid() only if the objects have moved by a certain threshold.
- This would work if we also extend the painted area around the rod, by the same threshold.
- we must also redo the paintGrid() when MT points are added or removed.
- 
- Such algortihm should lead to large CPU gain, if calling clear() or paintGrid() is limiting,
+ If a positive \a skin is set with setSkin(), paintGrid() works incrementally:
+ the segments are painted with a width extended by \a skin, and the positions at which
+ they were painted are recorded. At the next call, a segment is only erased and repainted
+ if one of its ends has moved by more than \a skin since it was painted.
+ All the segments of a Fiber are repainted if the Fiber has gained or lost points.
+ This can lead to large CPU gain, if calling clear() or paintGrid() is limiting,
  which is the case in particular in 3D, because the number of grid-cells is large.
+ The order of the segments in the lists differs from what a full repaint would give,
+ and thus the attachment are statistically equivalent, but not identical.
+ 
+ The lists of segments are stored according to FIBER_GRID_COMPACT.
 */
 
 class FiberGrid 
@@ -51,9 +90,30 @@ public:
     
     /// type for a list of FiberLocus
     typedef Array<FiberLocus const*> SegmentList;
+    
+    /// function called by forEachSegment() with a segment, the abscissa of the projection, the squared distance, and `arg`
+    typedef void (*SegmentVisitor)(FiberLocus const&, real abs, real dis, void* arg);
     //typedef std::vector<FiberLocus const*> SegmentList;
 
-    typedef Grid<DIM, SegmentList, unsigned int> grid_type;
+#if FIBER_GRID_COMPACT
+    /// a cell refers to the segments cellSegs[start] to cellSegs[start+cnt-1]
+    struct SegmentRange
+    {
+        unsigned start;
+        unsigned cnt;
+        void clear() { start = 0; cnt = 0; }
+    };
+
+    typedef SegmentRange cell_type;
+#else
+    typedef SegmentList cell_type;
+#endif
+
+#if FIBER_GRID_SPARSE
+    typedef GridSparse<DIM, cell_type, unsigned int> grid_type;
+#else
+    typedef Grid<DIM, cell_type, unsigned int> grid_type;
+#endif
     
 private:
     
@@ -65,14 +125,188 @@ private:
     
     ///the modulo object
     const Modulo * modulo;
+    
+    ///extra distance painted around the segments, to allow incremental painting
+    real  gridSkin;
+    
+    ///the width with which the segments were painted
+    real  gridWidth;
+    
+    ///positions at which the segments of a Fiber were painted
+    struct Record
+    {
+        Fiber const*        fib;   ///< the Fiber
+        FiberLocus const*   seg;   ///< address of the first segment of the Fiber
+        unsigned long       mark;  ///< value of paintCount when the Fiber was last seen
+        std::vector<Vector> pos;   ///< painted position of the vertices
+        std::vector<bool>   dirty; ///< segments that need to be painted
         
+        Record() : fib(0), seg(0), mark(0) {}
+    };
+    
+    ///type of map holding the Records, indexed by Fiber::number()
+    typedef std::map<unsigned long, Record> record_map;
+    
+    ///painted positions of all Fibers, only used if gridSkin > 0
+    record_map records;
+    
+    ///number of calls to paintGrid()
+    unsigned long paintCount;
+    
+    ///number of segments on the grid after the last call to paintGrid()
+    unsigned long nbSegments;
+    
+    ///number of segments painted during the last call to paintGrid()
+    unsigned long nbPainted;
+    
+    ///total number of segments painted since the start
+    unsigned long nbPaintedTotal;
+    
+#if FIBER_GRID_COMPACT
+    ///the segments of all cells, in the order of the cells
+    FiberLocus const** cellSegs;
+    
+    ///allocated size of cellSegs
+    unsigned cellSegsMax;
+    
+    ///indices of the cells that hold segments, in the order in which they were first counted
+    Array<unsigned> usedCells;
+    
+    ///increment the count of segments of `cell`, recording it in usedCells if it was empty
+    void countSegment(SegmentRange * cell)
+    {
+        if ( 0 == cell->cnt++ )
+            usedCells.push_back(cell - mGrid.cell_addr());
+    }
+    
+    ///reset the cells recorded in usedCells
+    void clearUsedCells();
+    
+    ///increment the count of segments for the cells (x_inf to x_sup, y, z)
+    static void countCell(int x_inf, int x_sup, int y, int z, void*, void*);
+    
+    ///increment the count of segments for the cells (x_inf to x_sup, y, z) of a periodic grid
+    static void countCellPeriodic(int x_inf, int x_sup, int y, int z, void*, void*);
+    
+    ///add a segment to the cells (x_inf to x_sup, y, z)
+    static void fillCell(int x_inf, int x_sup, int y, int z, void*, void*);
+    
+    ///add a segment to the cells (x_inf to x_sup, y, z) of a periodic grid
+    static void fillCellPeriodic(int x_inf, int x_sup, int y, int z, void*, void*);
+#endif
+    
+    ///return the first segment of the cell `indx`, and set `end` past its last segment
+    FiberLocus const** cellSegments(unsigned indx, FiberLocus const**& end) const
+    {
+#if FIBER_GRID_COMPACT
+        SegmentRange const& cell = mGrid.cell(indx);
+        end = cellSegs + cell.start + cell.cnt;
+        return cellSegs + cell.start;
+#else
+        SegmentList const* cell = mGrid.find(indx);
+        if ( !cell )
+        {
+            end = 0;
+            return 0;
+        }
+        end = cell->end();
+        return cell->begin();
+#endif
+    }
+    
+    ///call `paint` with `arg` for all the segments of the Fibers
+    void paintFibers(void (*paint)(int, int, int, int, void*, void*), void * arg,
+                     const Fiber * first, const Fiber * last, real width);
+    
+    ///a row of cells covered by a segment, recorded by paintParallel()
+    struct PaintedRow
+    {
+        unsigned           inf;   ///< index of the first cell of the row
+        unsigned           sup;   ///< index of the last cell of the row
+        FiberLocus const*  seg;   ///< the segment
+    };
+    
+    ///the rows painted by one thread
+    struct PaintBuffer
+    {
+        grid_type *        grid;  ///< the grid being painted
+        Array<PaintedRow>  rows;  ///< the rows, in the order in which they were painted
+        unsigned           cnt;   ///< number of segments painted
+    };
+    
+    ///the Fibers to be painted by paintParallel()
+    std::vector<Fiber const*> paintList;
+    
+    ///the width used by paintParallel()
+    real paintWidth;
+    
+    ///one buffer for each thread
+    std::vector<PaintBuffer> paintBuffers;
+    
+    ///record the rows of cells (x_inf to x_sup, y, z) in a PaintBuffer
+    static void bufferRow(int x_inf, int x_sup, int y, int z, void*, void*);
+    
+    ///record the rows of cells (x_inf to x_sup, y, z) of a periodic grid in a PaintBuffer
+    static void bufferRowPeriodic(int x_inf, int x_sup, int y, int z, void*, void*);
+    
+    ///function executed by the threads in paintParallel()
+    static void paintJob(void * arg, unsigned rank, unsigned nbt);
+    
+    ///paint the Fibers into paintBuffers, using multiple threads
+    void paintParallel(const Fiber * first, const Fiber * last, real width);
+
+    ///a Hand waiting to attach, recorded by requestAttach()
+    struct Request
+    {
+        Hand *    hand;    ///< the Hand
+        Vector    pos;     ///< position from which the Hand attaches
+        unsigned  cell;    ///< index of the cell containing `pos`
+        unsigned  order;   ///< rank of the request, to preserve the order within a cell
+    };
+    
+    ///if true, requestAttach() records the Hands, which are then handled by attachPending()
+    bool batchMode;
+    
+    ///if true, tryToAttach() may be called concurrently by multiple threads
+    bool concurrent;
+    
+    ///Hands waiting to attach
+    mutable std::vector<Request> requests;
+    
+    ///coordinates of the segments of one cell, used by attachPending()
+    std::vector<real> segData;
+    
+    ///distances and abscissa of the segments of one cell, used by attachPending()
+    std::vector<real> segDist, segAbs;
+    
+    ///indices of the segments within range, used by attachPending()
+    std::vector<unsigned> segHits;
+    
+    ///qsort() function used to order the Requests by cell
+    static int compareRequests(const void*, const void*);
+    
+    ///attach the Hands of requests[start, stop[, which are all in the same cell
+    void attachCell(unsigned start, unsigned stop);
+
+    ///project `w` on the segment, setting the closest point of the segment in `pos`
+    bool projectSegment(FiberLocus const&, Vector const& w, real& abs, real& dis, Vector& pos) const;
+    
+    ///call `func` for the segments of cell `indx` within distance sqrt(DD) of `w`
+    unsigned visitCell(unsigned indx, Vector const& w, real DD, bool unique, SegmentVisitor func, void* arg) const;
+
+    ///incremental version of paintGrid(), used if gridSkin > 0
+    void repaintGrid(const Fiber * first, const Fiber * last, real max_range);
+    
+    ///remove the segments of a Fiber from the grid, at their recorded positions
+    void eraseFiber(Record const&);
+
 public:
     
     ///creator
-    FiberGrid()             { modulo = 0; gridRange = -1; }
+    FiberGrid();
         
     ///destructor
-    virtual ~FiberGrid()    { }
+    virtual ~FiberGrid();
     
     
     ///create a grid to cover the specified Space with cells of width \a max_step at most
@@ -84,14 +318,47 @@ public:
     ///clear the grid
     void clear();
     
+    ///set the distance that segments may move before being repainted (0 = repaint everything)
+    void setSkin(real s)    { gridSkin = s; }
+    
     ///paint the Fibers, to be able to find up to a distance max_range
     void paintGrid(const Fiber * first, const Fiber * last, real max_range);
+    
+    ///number of segments on the grid
+    unsigned long nbSegmentsPainted()   const { return nbSegments; }
+    
+    ///number of segments painted during the last call to paintGrid()
+    unsigned long nbSegmentsRepainted() const { return nbPainted; }
+    
+    ///number of calls to paintGrid()
+    unsigned long nbCalls()             const { return paintCount; }
+    
+    ///total number of segments painted by all calls to paintGrid()
+    unsigned long nbSegmentsRepaintedTotal() const { return nbPaintedTotal; }
         
     ///given a position, find nearby Fiber segments and test attachement of the provided Hand
     bool tryToAttach(Vector const&, Hand&) const;
     
+    ///if true, attachments are done by attachPending(), and otherwise immediately
+    void setBatch(bool b)   { batchMode = b; }
+    
+    ///if true, tryToAttach() does not modify the grid, and can be called from multiple threads
+    void setConcurrent(bool b) { concurrent = b; }
+    
+    ///call tryToAttach(), or record the Hand to be attached by attachPending()
+    void requestAttach(Vector const&, Hand&) const;
+    
+    ///attach the Hands recorded by requestAttach(), handling them cell by cell
+    void attachPending();
+    
     /// return all fiber segments located at a distance D or less from P, except those belonging to \a exclude
     SegmentList nearbySegments(Vector const& P, real D, Fiber * exclude = 0);
+    
+    /// call `func` for each fiber segment located at a distance D or less from P, and return the number of calls
+    unsigned forEachSegment(Vector const& P, real D, SegmentVisitor func, void* arg) const;
+    
+    /// find the `cnt` fiber segments closest to P, within distance D, in order of increasing distance
+    unsigned nearestSegments(Vector const& P, real D, unsigned cnt, FiberLocus const* seg[], real dis[]) const;
 
     ///return the closest Segment to the given position, if it is closer than gridRange
     FiberLocus  closestSegment(Vector const&);
@@ -99,6 +366,9 @@ public:
     ///test the results of tryToAttach(), at a particular position
     void testAttach(FILE *, Vector place, Fiber * start, HandProp const*);
     
+    ///compare nearbySegments() and nearestSegments() with a search through all segments, at a particular position
+    unsigned testNearby(FILE *, Vector place, real D, Fiber * start);
+    
     
 #ifdef DISPLAY
     void display() const
@@ -11,7 +11,6 @@
 #include "exceptions.h"
 #include "clapack.h"
 
-extern Random RNG;
 
 /**
  This return the number of point N+1,
@@ -11,8 +11,9 @@
 #include "picket.h"
 #include "simul.h"
 #include "sim.h"
+#include "thread_pool.h"
+#include <algorithm>
 
-extern Random RNG;
 
 //------------------------------------------------------------------------------
 
@@ -239,18 +240,14 @@ Object * FiberSet::newObjectT(const Tag tag, int idx)
  Calls step() once for every Fiber.
  */
 
-void FiberSet::step()
+void FiberSet::prepare(PropertyList& properties)
 {
-    PropertyList plist = simul.properties.find_all(kind());
-    
-    // calculate the total length for each kind of Fiber:
-    for ( unsigned int k = 0; k < plist.size(); ++k )
-        static_cast<FiberProp*>(plist[k])->total_length = 0;
+    parallel = simul.prop->parallel_step && parallelPrepare(properties);
+}
 
-    for ( Fiber const* fib = first(); fib; fib = fib->next() )
-        const_cast<FiberProp*>(fib->prop)->total_length += fib->length();
-    
-    // calculate the ratio of free polymer:
+
+void FiberSet::calculateFreePolymer(PropertyList& plist)
+{
     for ( unsigned int k = 0; k < plist.size(); ++k )
     {
         FiberProp * p = static_cast<FiberProp*>(plist[k]);        
@@ -269,6 +266,28 @@ void FiberSet::step()
         else
             p->free_polymer = 1.0;
     }
+}
+
+
+void FiberSet::step()
+{
+    PropertyList plist = simul.properties.find_all(kind());
+    
+    if ( parallel )
+    {
+        stepParallel(plist);
+        return;
+    }
+    
+    // calculate the total length for each kind of Fiber:
+    for ( unsigned int k = 0; k < plist.size(); ++k )
+        static_cast<FiberProp*>(plist[k])->total_length = 0;
+
+    for ( Fiber const* fib = first(); fib; fib = fib->next() )
+        const_cast<FiberProp*>(fib->prop)->total_length += fib->length();
+    
+    // calculate the ratio of free polymer:
+    calculateFreePolymer(plist);
 
     
     /*
@@ -289,6 +308,155 @@ void FiberSet::step()
 }
 
 
+//------------------------------------------------------------------------------
+#pragma mark - Parallel Step
+
+/**
+ The glue of the Fibers are Singles, which cannot be managed concurrently.
+ */
+bool FiberSet::parallelPrepare(PropertyList& properties)
+{
+    PropertyList plist = properties.find_all(kind());
+    
+    for ( PropertyList::const_iterator n = plist.begin(); n != plist.end(); ++n )
+    {
+        FiberProp const * p = static_cast<FiberProp const*>(*n);
+        if ( p->glue )
+        {
+            MSG.warning("fiber:%s with glue cannot be stepped in parallel\n", p->name().c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+
+void FiberSet::sumSection(const unsigned s)
+{
+    std::vector<real>& len = lengths[s];
+    for ( unsigned k = 0; k < len.size(); ++k )
+        len[k] = 0;
+    
+    Node * const end = sections[s+1];
+    for ( Node * n = sections[s]; n != end; n = n->next() )
+    {
+        Fiber const* fib = static_cast<Fiber*>(n);
+        len[fib->prop->index()] += fib->length();
+    }
+}
+
+
+void FiberSet::sumJob(void * arg, unsigned rank, unsigned nbt)
+{
+    FiberSet * set = static_cast<FiberSet*>(arg);
+    unsigned start, end;
+    ThreadPool::partition(NB_SECTIONS, rank, nbt, start, end);
+    for ( unsigned s = start; s < end; ++s )
+        set->sumSection(s);
+}
+
+
+/**
+ The FiberBinders are not checked by Fiber::updateBinders(), since this may detach
+ Hands belonging to Couples with another Hand on a Fiber of another section.
+ They are instead recorded here, and checked later by stepParallel().
+ */
+void FiberSet::stepSection(const unsigned s)
+{
+    Random * rng = threadRNG;
+    threadRNG = sectionRNG() + s;
+    
+    std::vector<FiberBinder*>& out = outside[s];
+    out.clear();
+    
+    Node * const end = sections[s+1];
+    for ( Node * n = sections[s]; n != end; n = n->next() )
+    {
+        Fiber * fib = static_cast<Fiber*>(n);
+        fib->step();
+        for ( FiberBinder * fb = fib->firstBinder(); fb; fb = fb->next() )
+        {
+            if ( !fb->within() )
+                out.push_back(fb);
+        }
+    }
+    
+    threadRNG = rng;
+}
+
+
+void FiberSet::stepJob(void * arg, unsigned rank, unsigned nbt)
+{
+    FiberSet * set = static_cast<FiberSet*>(arg);
+    unsigned start, end;
+    ThreadPool::partition(NB_SECTIONS, rank, nbt, start, end);
+    for ( unsigned s = start; s < end; ++s )
+        set->stepSection(s);
+}
+
+
+/**
+ The list is divided into NB_SECTIONS sections, each stepped with its own
+ Random Number Generator, such that the results do not depend on the number of threads.
+ 
+ The structural changes are made outside the concurrent part:
+ - the cuts registered by Fiber::sever() are performed first, such that the
+   new Fibers are stepped, as they would be by step(),
+ - the total length of each kind of Fiber is obtained by summing the partial
+   sums of the sections, in the order of the sections,
+ - the Fibers given to ObjectSet::erase() are deleted at the end (see deferLinks()),
+ - the FiberBinders outside the range of their Fiber are then handled in order.
+ .
+ */
+void FiberSet::stepParallel(PropertyList& plist)
+{
+    for ( Fiber * fib = first(); fib; fib = fib->next() )
+        fib->delayedSevering();
+    
+    sectionRNG();
+    divideList(nodes, NB_SECTIONS, sections);
+
+    // calculate the total length for each kind of Fiber:
+    unsigned nbp = 0;
+    for ( unsigned int k = 0; k < plist.size(); ++k )
+        nbp = std::max(nbp, (unsigned)plist[k]->index()+1);
+    
+    for ( unsigned s = 0; s < NB_SECTIONS; ++s )
+        lengths[s].resize(nbp);
+    
+    POOL.run(sumJob, this);
+    
+    for ( unsigned int k = 0; k < plist.size(); ++k )
+    {
+        FiberProp * p = static_cast<FiberProp*>(plist[k]);
+        p->total_length = 0;
+        for ( unsigned s = 0; s < NB_SECTIONS; ++s )
+            p->total_length += lengths[s][p->index()];
+    }
+    
+    calculateFreePolymer(plist);
+    
+    deferLinks(true);
+    Fiber::deferChecks = true;
+    
+    POOL.run(stepJob, this);
+    
+    Fiber::deferChecks = false;
+    
+    for ( unsigned s = 0; s < NB_SECTIONS; ++s )
+    {
+        std::vector<FiberBinder*>& out = outside[s];
+        for ( std::vector<FiberBinder*>::iterator i = out.begin(); i != out.end(); ++i )
+        {
+            if ( (*i)->attached() )
+                (*i)->checkFiberRange();
+        }
+    }
+    
+    deferLinks(false);
+}
+
+
 //------------------------------------------------------------------------------
 /**
  Cut all Fibers along the plane defined by n.x + a = 0.
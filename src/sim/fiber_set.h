@@ -21,11 +21,44 @@ class FiberSet : public ObjectSet
 private:
     
     FiberSet();
+    
+    /// flag to step the Fibers on multiple threads
+    bool       parallel;
+    
+    /// sections[s] is the first Fiber of section `s`
+    Node *     sections[NB_SECTIONS+1];
+    
+    /// the length of the Fibers of each section, indexed by FiberProp::index()
+    std::vector<real> lengths[NB_SECTIONS];
+    
+    /// the FiberBinders that are outside the range of their Fiber, in each section
+    std::vector<FiberBinder*> outside[NB_SECTIONS];
+    
+    /// calculate FiberProp::free_polymer from FiberProp::total_length
+    void       calculateFreePolymer(PropertyList&);
+    
+    /// true if all the Fibers can be stepped concurrently
+    bool       parallelPrepare(PropertyList& properties);
+    
+    /// sum the length of the Fibers of section `s`
+    void       sumSection(unsigned s);
+    
+    /// call sumSection() for a fraction of the sections
+    static void sumJob(void*, unsigned rank, unsigned nbt);
+
+    /// Monte-Carlo step for the Fibers of section `s`
+    void       stepSection(unsigned s);
+    
+    /// call stepSection() for a fraction of the sections
+    static void stepJob(void*, unsigned rank, unsigned nbt);
+    
+    /// Monte-Carlo step on multiple threads
+    void       stepParallel(PropertyList&);
 
 public:
     
     /// creator
-    FiberSet(Simul& s) : ObjectSet(s) {}
+    FiberSet(Simul& s) : ObjectSet(s), parallel(false) {}
     
     /// destructor
     virtual ~FiberSet() { }
@@ -70,6 +103,9 @@ public:
     /// Cut all segments intersecting the plane defined by <em> n.x + a = 0 </em>
     void cutAlongPlane(Vector const& n, real a, bool (*func)(Object const*, void*), void*);
     
+    /// prepare for step()
+    void prepare(PropertyList& properties);
+    
     /// Monte-Carlo step for every Fiber
     void step();
     
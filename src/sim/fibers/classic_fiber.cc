@@ -11,7 +11,6 @@
 #include "simul.h"
 #include "space.h"
 
-extern Random RNG;
 
 //------------------------------------------------------------------------------
 
@@ -13,7 +13,6 @@
 #include "space.h"
 #include "picket.h"
 
-extern Random RNG;
 
 //========================================================================
 //  - - - - - - - - - - - - - - CONSTRUCTORS - - - - - - - - - - - - - - -
@@ -7,7 +7,6 @@
 #include "cblas.h"
 #include "sim.h"
 
-extern Random RNG;
 
 template < > 
 void FieldBase<FieldScalar>::prepare()
@@ -8,7 +8,6 @@
 #include "fiber_prop.h"
 #include "simul.h"
 #include "sim.h"
-extern Random RNG;
 
 //------------------------------------------------------------------------------
 
@@ -25,6 +24,16 @@ Hand::~Hand()
     prop = 0;
 }
 
+
+/**
+ The Slab is never deleted, since objects may be destroyed after the end of main()
+ */
+Slab& Hand::slab()
+{
+    static Slab * s = new Slab("hand, couple and single");
+    return *s;
+}
+
 //------------------------------------------------------------------------------
 #pragma mark -
 
@@ -75,7 +84,8 @@ bool Hand::attachmentAllowed(FiberBinder & fb)
  */
 void Hand::attach(FiberBinder & fb)
 {
-    assert_true( !attached() && !linked() );
+    assert_true( !attached() );
+    assert_true( deferLinks || !linked() );
     assert_true( fb.attached() );    
 
     FiberBinder::attach(fb);
@@ -204,8 +214,7 @@ void Hand::stepFree(const FiberGrid& grid, Vector const & pos)
     if ( nextAttach <= 0 )
     {
         nextAttach = RNG.exponential();
-        if ( grid.tryToAttach(pos, *this) )
-            return;
+        grid.requestAttach(pos, *this);
     }
 }
 
@@ -4,6 +4,7 @@
 #define HAND_H
 
 #include "fiber_binder.h"
+#include "slab.h"
 
 class HandMonitor;
 class FiberGrid;
@@ -76,6 +77,15 @@ public:
 
     /// destructor
     virtual ~Hand();
+    
+    /// the Slab from which Hands, Couples and Singles are allocated
+    static Slab&   slab();
+    
+    /// allocate memory from slab()
+    static void *  operator new(size_t s)               { return slab().allocate(s); }
+    
+    /// return memory to slab()
+    static void    operator delete(void * p, size_t s)  { slab().release(p, s); }
 
     /// tell if attachment at given site is possible
     virtual bool   attachmentAllowed(FiberBinder& site);
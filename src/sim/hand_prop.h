@@ -164,6 +164,9 @@ public:
     
     /// return a Hand with this property
     virtual Hand * newHand(HandMonitor* h) const;
+    
+    /// true if the Hands can be stepped concurrently, because they do not modify the Fibers
+    virtual bool   concurrent() const { return true; }
 
     /// identifies the property
     std::string kind() const { return "hand"; }
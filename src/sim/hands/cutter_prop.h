@@ -55,6 +55,9 @@ public:
     /// return a Hand with this property
     virtual Hand * newHand(HandMonitor* h) const;
     
+    /// a Cutter severs Fibers
+    bool           concurrent() const { return false; }
+    
     /// set default values
     void clear();
     
@@ -6,7 +6,6 @@
 #include "exceptions.h"
 #include "iowrapper.h"
 #include "tubule_prop.h"
-extern Random RNG;
 
 //------------------------------------------------------------------------------
 
@@ -9,8 +9,14 @@
 #include "fiber_set.h"
 #include "hand_monitor.h"
 #include "simul.h"
+#include <algorithm>
+#include <pthread.h>
 
-extern Random RNG;
+
+std::vector<Nucleator::Request> Nucleator::pending;
+
+/// lock protecting Nucleator::pending
+static pthread_mutex_t pendingLock = PTHREAD_MUTEX_INITIALIZER;
 
 //------------------------------------------------------------------------------
 
@@ -141,6 +147,19 @@ void Nucleator::stepFree(const FiberGrid&, Vector const & pos)
     if ( gspTime < 0 )
     {
         gspTime = RNG.exponential();
+        
+        // the lists cannot be modified if Hands are stepped concurrently:
+        if ( FiberBinder::deferLinks )
+        {
+            Request req;
+            req.hand = this;
+            req.pos  = pos;
+            pthread_mutex_lock(&pendingLock);
+            pending.push_back(req);
+            pthread_mutex_unlock(&pendingLock);
+            return;
+        }
+        
         try {
             nucleate(pos);
         }
@@ -154,6 +173,44 @@ void Nucleator::stepFree(const FiberGrid&, Vector const & pos)
 
 
 
+bool Nucleator::earlierRequest(Request const& a, Request const& b)
+{
+    Number na = a.hand->haMonitor->objNumber();
+    Number nb = b.hand->haMonitor->objNumber();
+    if ( na != nb )
+        return na < nb;
+    // the two Hands of a Couple:
+    return a.hand < b.hand;
+}
+
+
+/**
+ The requests are processed in the order of the Number of the objects containing
+ the Nucleators, such that the result does not depend on the order of the requests.
+ */
+void Nucleator::nucleatePending()
+{
+    if ( pending.empty() )
+        return;
+    
+    std::sort(pending.begin(), pending.end(), earlierRequest);
+    
+    for ( std::vector<Request>::iterator r = pending.begin(); r != pending.end(); ++r )
+    {
+        try {
+            r->hand->nucleate(r->pos);
+        }
+        catch( Exception & e )
+        {
+            pending.clear();
+            e << "\nException occured while executing nucleator:code";
+            throw;
+        }
+    }
+    pending.clear();
+}
+
+
 void Nucleator::stepUnloaded()
 {
     assert_true( attached() );
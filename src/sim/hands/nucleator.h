@@ -4,6 +4,7 @@
 #define NUCLEATOR_H
 
 #include "hand.h"
+#include <vector>
 class NucleatorProp;
 
 /// A Hand that can nucleate a Fiber
@@ -32,6 +33,19 @@ class Nucleator : public Hand
     /// Gillespie time
     real     gspTime;
     
+    /// a nucleation that was deferred, because the lists were deferred
+    struct Request
+    {
+        Nucleator * hand;   ///< the Nucleator
+        Vector      pos;    ///< the position of nucleation
+    };
+    
+    /// the nucleations waiting to be done by nucleatePending()
+    static std::vector<Request> pending;
+    
+    /// order Requests by the Number of the objects containing the Nucleators
+    static bool  earlierRequest(Request const&, Request const&);
+
 private:
     
     /// disabled default constructor
@@ -52,6 +66,9 @@ public:
     /// create a new Fiber
     void   nucleate(Vector pos);
     
+    /// perform the nucleations that were deferred while FiberBinder::deferLinks was set
+    static void nucleatePending();
+    
     /// simulate when is not attached
     void   stepFree(const FiberGrid&, Vector const & pos);
 
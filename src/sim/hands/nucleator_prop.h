@@ -101,6 +101,9 @@ public:
     /// return a Hand with this property
     virtual Hand * newHand(HandMonitor* h) const;
     
+    /// nucleation can be deferred, but an `addictive` Nucleator changes the state of the Fiber
+    bool           concurrent() const { return !addictive; }
+    
     /// set default values
     void clear();
     
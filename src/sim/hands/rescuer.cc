@@ -6,7 +6,6 @@
 #include "exceptions.h"
 #include "iowrapper.h"
 #include "simul.h"
-extern Random RNG;
 
 //------------------------------------------------------------------------------
 
@@ -53,6 +53,9 @@ public:
     /// return a Hand with this property
     virtual Hand * newHand(HandMonitor* h) const;
     
+    /// a Rescuer changes the state of the Fibers
+    bool           concurrent() const { return false; }
+    
     /// set default values
     void clear();
     
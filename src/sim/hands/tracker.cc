@@ -7,7 +7,6 @@
 #include "iowrapper.h"
 #include "tubule_prop.h"
 #include "simul.h"
-extern Random RNG;
 
 
 //------------------------------------------------------------------------------
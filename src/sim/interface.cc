@@ -6,7 +6,6 @@
 #include "tictoc.h"
 #include <fstream>
 
-extern Random RNG;
 
 #define VERBOSE_INTERFACE 0
 
@@ -28,8 +28,11 @@
 #include "clapack.h"
 #include "exceptions.h"
 #include <fstream>
+#include <cstdlib>
 #include "allot.h"
 #include "vecprint.h"
+#include "thread_pool.h"
+#include "tictoc.h"
 
 #include "meca_inter.cc"
 
@@ -38,8 +41,20 @@
 Meca::Meca()
 {
     nbPts = 0;
+    nbPtsOld = 0;
     largestBlock = 0;
     allocated = 0;
+    workSize = 0;
+    precondMode = 0;
+    precondBuildTime = 0;
+    precondApplyTime = 0;
+    precondReuse = 0;
+    precondDrift = 0;
+    precondRenew = true;
+    precondModeOld = 0;
+    precondTimeStep = 0;
+    precondIter = 0;
+    precondBuilt = 0;
     vPTS = 0;
     vSOL = 0;
     vBAS = 0;
@@ -48,6 +63,18 @@ Meca::Meca()
     vTMP = 0;
     use_mB = false;
     use_mC = false;
+    nbComponents = 0;
+    logFile = 0;
+    logBinary = false;
+    logStep = 0;
+    prepareTime = 0;
+}
+
+
+Meca::~Meca()
+{
+    if ( logFile )
+        fclose(logFile);
 }
 
 
@@ -85,26 +112,55 @@ void Meca::add(Mecable* o)
 #pragma mark -
 
 /**
- Compute the linear part of the forces.
- The forces in a system with coordinates X are:
- @code
- forces = (mB+mC)*X + vBAS
- @endcode
- 
- This will perform:
- @code
- Y = Y + (mB+mC)*X
- @endcode
+ The Mecables are divided in `nbt` contiguous groups with similar numbers of points.
+ Since the points of a Mecable are contiguous, each group corresponds to a contiguous
+ range of lines in the matrices and vectors.
  */
-void Meca::addLinearForces( const real* X, real* Y, const bool with_rigidity ) const
-{    
+void Meca::partition(unsigned rank, unsigned nbt, unsigned& start, unsigned& end) const
+{
+    const index_type lo = (index_type)( ( (unsigned long)nbPts * rank ) / nbt );
+    const index_type hi = (index_type)( ( (unsigned long)nbPts * ( rank+1 ) ) / nbt );
+    
+    // find the first Mecables with matIndex() >= lo and >= hi, by bisection:
+    unsigned a = 0, b = objs.size();
+    while ( a < b )
+    {
+        unsigned m = ( a + b ) / 2;
+        if ( objs[m]->matIndex() < lo ) a = m + 1; else b = m;
+    }
+    start = a;
+    
+    b = objs.size();
+    while ( a < b )
+    {
+        unsigned m = ( a + b ) / 2;
+        if ( objs[m]->matIndex() < hi ) a = m + 1; else b = m;
+    }
+    end = ( rank+1 < nbt ) ? a : objs.size();
+}
+
+
+/**
+ Compute the linear part of the forces, for the points of the Mecables [start, end[.
+ This only modifies the corresponding lines of Y, and the same operations are
+ performed in the same order for any given line, whatever the range.
+ */
+void Meca::addLinearForces(const real* X, real* Y, const bool with_rigidity,
+                           const unsigned start, const unsigned end) const
+{
+    if ( start >= end )
+        return;
+    
+    const index_type inx = objs[start]->matIndex();
+    const index_type sup = objs[end-1]->matIndex() + objs[end-1]->nbPoints();
+    
 #if ( DIM > 1 )
     if ( with_rigidity )
     {
-        for ( Mecable ** mci = objs.begin(); mci < objs.end(); ++mci )
+        for ( unsigned ii = start; ii < end; ++ii )
         {
-            const index_type indx = DIM * (*mci)->matIndex();
-            (*mci)->addRigidity( X+indx, Y+indx );
+            const index_type indx = DIM * objs[ii]->matIndex();
+            objs[ii]->addRigidity( X+indx, Y+indx );
         }
     }
 #endif
@@ -113,17 +169,47 @@ void Meca::addLinearForces( const real* X, real* Y, const bool with_rigidity ) c
     if ( use_mB )
     {
 #if ( DIM == 1 )
-        mB.vecMulAdd( X, Y );
+        mB.vecMulAdd( X, Y, inx, sup );
 #elif ( DIM == 2 )
-        mB.vecMulAddIso2D( X, Y );
+        mB.vecMulAddIso2D( X, Y, inx, sup );
 #elif ( DIM == 3 )
-        mB.vecMulAddIso3D( X, Y );
+        mB.vecMulAddIso3D( X, Y, inx, sup );
 #endif
     }
     
     // Y <- Y + mC * X
     if ( use_mC )
-        mC.vecMulAdd( X, Y );
+        mC.vecMulAdd( X, Y, DIM*inx, DIM*sup );
+}
+
+
+void Meca::addLinearForcesJob(void * arg, const unsigned rank, const unsigned nbt)
+{
+    Task const* task = static_cast<Task*>(arg);
+    unsigned start, end;
+    task->meca->partition(rank, nbt, start, end);
+    task->meca->addLinearForces(task->X, task->Y, task->rigidity, start, end);
+}
+
+
+/**
+ Compute the linear part of the forces.
+ The forces in a system with coordinates X are:
+ @code
+ forces = (mB+mC)*X + vBAS
+ @endcode
+ 
+ This will perform:
+ @code
+ Y = Y + (mB+mC)*X
+ @endcode
+ 
+ The work is distributed over the threads of POOL.
+ */
+void Meca::addLinearForces( const real* X, real* Y, const bool with_rigidity ) const
+{
+    Task task = { this, X, Y, with_rigidity };
+    POOL.run(addLinearForcesJob, &task);
 }
 
 
@@ -149,27 +235,31 @@ void Meca::computeForces( const real* X, real* Y, const bool with_rigidity ) con
 
 //------------------------------------------------------------------------------
 /**
- calculate the matrix product needed for the conjugate gradient algorithm
+ calculate the lines of the matrix product corresponding to the Mecables [start, end[:
  @code
  Y = X - time_step * P ( mB + mC + P' ) * X;
  @endcode
+ Only the corresponding lines of vTMP and Y are modified.
 */
-void Meca::multiply( const real* X, real* Y ) const
+void Meca::multiply( const real* X, real* Y, const unsigned start, const unsigned end ) const
 {
-    // vTMP is a temporary storage !
-    assert_true( X != Y  &&  X != vTMP  &&  Y != vTMP );
+    if ( start >= end )
+        return;
+    
+    const index_type inx = DIM * objs[start]->matIndex();
+    const index_type sup = DIM * ( objs[end-1]->matIndex() + objs[end-1]->nbPoints() );
 
     // vTMP <= Forces = ( mB + mC ) * X
-    blas_xzero(DIM*nbPts, vTMP);
-    addLinearForces( X, vTMP, true );
+    blas_xzero(sup-inx, vTMP+inx);
+    addLinearForces( X, vTMP, true, start, end );
     
     /*
      Constrained dynamic: Y <- X - time_step * P ( mB + mC ) * X;
      ALWAYS USE THIS!
      */
-    for ( Mecable ** mci = objs.begin(); mci < objs.end(); ++mci )
+    for ( unsigned ii = start; ii < end; ++ii )
     {
-        Mecable const * mec = *mci;
+        Mecable const * mec = objs[ii];
         const index_type indx = DIM * mec->matIndex();
 #ifdef PROJECTION_DIFF
         mec->addProjectionDiff( X+indx, vTMP+indx );
@@ -177,7 +267,35 @@ void Meca::multiply( const real* X, real* Y ) const
         mec->setSpeedsFromForces( vTMP+indx, Y+indx, -time_step );
     }
     
-    blas_xaxpy(DIM*nbPts, 1.0, X, 1, Y, 1);
+    blas_xaxpy(sup-inx, 1.0, X+inx, 1, Y+inx, 1);
+}
+
+
+void Meca::multiplyJob(void * arg, const unsigned rank, const unsigned nbt)
+{
+    Task const* task = static_cast<Task*>(arg);
+    unsigned start, end;
+    task->meca->partition(rank, nbt, start, end);
+    task->meca->multiply(task->X, task->Y, start, end);
+}
+
+
+/**
+ calculate the matrix product needed for the conjugate gradient algorithm
+ @code
+ Y = X - time_step * P ( mB + mC + P' ) * X;
+ @endcode
+ The Mecables are distributed over the threads of POOL, by groups containing
+ similar numbers of points, and each thread calculates the corresponding lines of Y.
+ The result does not depend on the number of threads.
+*/
+void Meca::multiply( const real* X, real* Y ) const
+{
+    // vTMP is a temporary storage !
+    assert_true( X != Y  &&  X != vTMP  &&  Y != vTMP );
+
+    Task task = { this, X, Y, true };
+    POOL.run(multiplyJob, &task);
 }
 
 //==========================================================================
@@ -314,20 +432,105 @@ void Meca::getBlockS( const Mecable * mec, real* blk ) const
     delete [] tmp2;
 }
 
+//------------------------------------------------------------------------------
+/**
+ Extract the upper band of the symmetric matrix ( mB + mC + R + P' ) corresponding
+ to a Mecable, for the interactions between points that are less than `bw` apart.
+ The result uses LAPACK symmetric band storage, with kd = DIM*(bw+1)-1:
+ element (i, j) with i <= j is stored in band[kd+i-j+(kd+1)*j].
+ 
+ The internal forces R + P' are obtained by applying addRigidity() and addProjectionDiff()
+ to a sum of unit vectors, on points that are separated by more than 2*bw, such that
+ the cost is proportional to the number of points, rather than its square.
+ */
+void Meca::getBand(const Mecable * mec, real* band, const unsigned bw) const
+{
+    const unsigned ps = mec->nbPoints();
+    const unsigned bs = DIM * ps;
+    const unsigned kd = DIM * ( bw + 1 ) - 1;
+    const unsigned stride = 2 * bw + 1;
+    
+    blas_xzero((kd+1)*bs, band);
+    
+    Allot<real> tmp1(std::max(bs, (bw+1)*ps), 0);
+    Allot<real> tmp2(bs, 0);
+    
+    for ( unsigned c = 0; c < stride; ++c )
+    {
+        for ( unsigned d = 0; d < DIM; ++d )
+        {
+            blas_xzero(bs, tmp1);
+            blas_xzero(bs, tmp2);
+            for ( unsigned p = c; p < ps; p += stride )
+                tmp1[DIM*p+d] = 1;
+#if ( DIM > 1 )
+            mec->addRigidity(tmp1, tmp2);
+#endif
+#ifdef PROJECTION_DIFF
+            mec->addProjectionDiff(tmp1, tmp2);
+#endif
+            // the lines of the points within `bw` of `p` only depend on column DIM*p+d
+            for ( unsigned p = c; p < ps; p += stride )
+            {
+                const unsigned jj = DIM * p + d;
+                for ( unsigned ii = DIM * ( p > bw ? p - bw : 0 ); ii <= jj; ++ii )
+                    band[kd+ii-jj+(kd+1)*jj] += tmp2[ii];
+            }
+        }
+    }
+    
+    if ( use_mB )
+    {
+        // extract the isotropic band, and duplicate it in each dimension:
+        blas_xzero((bw+1)*ps, tmp1);
+        mB.addDiagonalBand(tmp1, mec->matIndex(), ps, bw);
+        for ( unsigned q = 0; q < ps; ++q )
+        {
+            for ( unsigned p = ( q > bw ? q - bw : 0 ); p <= q; ++p )
+            {
+                const real a = tmp1[bw+p-q+(bw+1)*q];
+                for ( unsigned d = 0; d < DIM; ++d )
+                    band[kd+DIM*p-DIM*q+(kd+1)*(DIM*q+d)] += a;
+            }
+        }
+    }
+    
+    if ( use_mC )
+        mC.addDiagonalBand(band, DIM*mec->matIndex(), bs, kd);
+}
+
+
 //------------------------------------------------------------------------------
 #pragma mark -
 /**
- @todo Do not call lapack_xgetri() here, but call lapack_xgetrs() in Meca::precondition()
+ The block is factorized by LU decomposition, keeping the pivots in Mecable::pivot().
+ If ( precondMode == 1 ), the inverse of the block is then calculated explicitly,
+ and otherwise the LU factors are kept, to be used by lapack_xgetrs() in precondition().
  
+ If ( precondMode == 3 ), the Mecables that implement a banded preconditionner
+ calculate it from the band of the matrix, without forming the full block,
+ and the other Mecables use the LU factors of their block.
  */
-int Meca::computePreconditionner(Mecable* mec, int* ipiv, real* work, int worksize)
+int Meca::computePreconditionner(Mecable* mec, real* work, int worksize)
 {
-    assert_true( ipiv && work );
+    assert_true( work );
     
     int bs = DIM * mec->nbPoints();
+    
+    if ( precondMode == 3  &&  mec->bandWidth() > 0 )
+    {
+        const unsigned bw = mec->bandWidth();
+        Allot<real> band(DIM*(bw+1)*bs, 0);
+        getBand(mec, band, bw);
+        if ( mec->factorizeBand(band, -time_step) )
+            return 2;      //failed to factorize matrix !!!
+        return 0;
+    }
+    
     real* blk = mec->allocateBlock(bs);
     if ( blk == 0 )
         return 1;
+    int* ipiv = mec->pivot();
     
     //we get the block corresponding to this Mecable:
     getBlock(mec, blk);
@@ -343,15 +546,19 @@ int Meca::computePreconditionner(Mecable* mec, int* ipiv, real* work, int worksi
         blk2[kk] -= blk[kk];
     real err = blas_xnrm8(bs*bs,blk2);
     fprintf(stderr, "block difference: %f\n", err);
-    delete(blk2);
+    delete[] blk2;
 #endif
     
-    //invert the matrix blk by LU factorization:
+    //factorize the matrix blk by LU decomposition:
     int info = 0;
     
     lapack_xgetrf( bs, bs, blk, bs, ipiv, &info );
     if ( info ) return 2;      //failed to factorize matrix !!!
     
+    if ( precondMode != 1 )
+        return 0;
+    
+    //invert the matrix blk from its LU factors:
     lapack_xgetri( bs, blk, bs, ipiv, work, worksize, &info );
     if ( info ) return 3;      //failed to invert matrix !!!
 
@@ -402,15 +609,99 @@ int Meca::computePreconditionner(Mecable* mec, int* ipiv, real* work, int worksi
 }
 
 
-// Using dynamic memory to compute preconditionner
 /**
- The code can be parallelized here:
- - allocate temporary memory for each thread
- - distribute block calculation to different threads
+ This is used to detect changes in the interactions of a Mecable,
+ which may call for a new preconditionner block.
+ */
+real Meca::blockStiffness(const Mecable * mec) const
+{
+    real res = 0;
+    const index_type inx = mec->matIndex();
+    const index_type end = inx + mec->nbPoints();
+    
+    for ( index_type ii = inx; ii < end; ++ii )
+    {
+        real const* a = mB.addr(ii, ii);
+        if ( a ) res += fabs(*a);
+    }
+    
+    for ( index_type ii = DIM*inx; ii < DIM*end; ++ii )
+    {
+        real const* a = mC.addr(ii, ii);
+        if ( a ) res += fabs(*a);
+    }
+    return res;
+}
+
+
+/**
+ When blocks are reused ( precondReuse > 0 ), a block is recalculated if:
+ - the number of points of the Mecable has changed,
+ - the block is older than `precondReuse` time steps,
+ - the stiffness signature has changed by more than `precondDrift` (relative),
+ - precondRenew is true (new time_step, new mode, or degraded convergence),
+ .
+ */
+bool Meca::blockIsStale(const Mecable * mec, const real stiffness) const
+{
+    if ( precondRenew  ||  mec->blockChanged() )
+        return true;
+    
+    if ( mec->blockAge() >= precondReuse )
+        return true;
+    
+    real ref = mec->blockStiffness();
+    return fabs( stiffness - ref ) > precondDrift * ref;
+}
+
+
+/**
+ Compute the preconditionner blocks of the Mecables that are attributed to
+ thread `rank` out of `nbt`, using temporary memory private to this thread.
+ The objects are distributed in an interleaved manner, to balance the load,
+ and since each block is calculated independently, the result does not
+ depend on the number of threads.
+ */
+void Meca::computePreconditionnerJob(void * arg, const unsigned rank, const unsigned nbt)
+{
+    Meca * meca = static_cast<Meca*>(arg);
+    const int work_size = meca->workSize;
+    
+    // allocate memory:
+    real* work = new real[work_size];
+    
+    const unsigned nbo = meca->objs.size();
+    for ( unsigned ii = rank; ii < nbo; ii += nbt )
+    {
+        Mecable * mec = meca->objs[ii];
+        assert_true( mec->nbPoints() <= meca->largestBlock );
+        real stiff = meca->blockStiffness(mec);
+        if ( meca->blockIsStale(mec, stiff) )
+        {
+            int res = meca->computePreconditionner(mec, work, work_size);
+            mec->useBlock(res==0);
+            mec->renewBlock(stiff);
+        }
+        else
+            mec->ageBlock();
+    }
+    
+    delete[] work;
+}
+
+
+/**
+ The calculation of the blocks is distributed over the threads of POOL,
+ each thread using its own temporary memory.
+ The time spent is added to precondBuildTime.
  */
 int Meca::computePreconditionner()
 {
-    int work_size = 2048;
+    double time = TicToc::milli_seconds();
+    workSize = 2048;
+    
+    if ( precondModeOld != precondMode  ||  precondTimeStep != time_step )
+        precondRenew = true;
     
     if ( 1 )
     {
@@ -420,48 +711,451 @@ int Meca::computePreconditionner()
         lapack_xgetri(block_size, 0, block_size, &tmp, &w, -1, &info);
         if ( info == 0 )
         {
-            work_size = (int)w;
-            //std::cerr << "Lapack::dgetri optimal size is " << work_size << std::endl;
+            workSize = (int)w;
+            //std::cerr << "Lapack::dgetri optimal size is " << workSize << std::endl;
         }
     }
     
+    POOL.run(computePreconditionnerJob, this);
     
-    // allocate memory:
-    int* ipiv  = new int[DIM*largestBlock];
-    real* work = new real[work_size];
+    precondBuilt = 0;
+    for ( Mecable ** mci = objs.begin(); mci < objs.end(); ++mci )
+        precondBuilt += ( (*mci)->blockAge() == 0 );
+    
+    precondModeOld = precondMode;
+    precondTimeStep = time_step;
+    precondRenew = ( precondReuse == 0 );
+    precondBuildTime += TicToc::milli_seconds() - time;
+    return 0;
+}
+
 
+//------------------------------------------------------------------------------
+/**
+ Apply the block-diagonal preconditionner, using either the inverse of the blocks,
+ their LU factors, or a banded factorization, depending on precondMode.
+ The time spent is added to precondApplyTime.
+ */
+void Meca::precondition(const real* X, real* Y) const
+{
+    double time = TicToc::milli_seconds();
+    
     for ( Mecable ** mci = objs.begin(); mci < objs.end(); ++mci )
     {
-        Mecable * mec = *mci;
-        assert_true( mec->nbPoints() <= largestBlock );
-        int res = computePreconditionner(mec, ipiv, work, work_size);
-        mec->useBlock(res==0);
+        const index_type indx = DIM * (*mci)->matIndex();
+        preconditionBlock(*mci, X+indx, Y+indx);
     }
     
-    delete[] ipiv;
-    delete[] work;
-    return 0;
+    precondApplyTime += TicToc::milli_seconds() - time;
+}
+
+
+/**
+ X and Y are the vectors of the Mecable, of size DIM * nbPoints()
+ */
+void Meca::preconditionBlock(Mecable const* mec, const real* X, real* Y) const
+{
+    const unsigned bs = DIM * mec->nbPoints();
+    if ( mec->useBlock() )
+    {
+        if ( precondMode == 1 )
+        {
+            //we use the inverse of the block that was calculated
+            blas_xgemv('N', bs, bs, 1.0, mec->block(), bs, X, 1, 0.0, Y, 1);
+        }
+        else if ( precondMode == 3  &&  mec->bandWidth() > 0 )
+        {
+            //we solve with the banded factorization:
+            blas_xcopy( bs, X, 1, Y, 1);
+            mec->solveBand(Y);
+        }
+        else
+        {
+            //we solve with the LU factors of the block:
+            int info = 0;
+            blas_xcopy( bs, X, 1, Y, 1);
+            lapack_xgetrs('N', bs, 1, mec->block(), bs, mec->pivot(), Y, bs, &info);
+            assert_true( info == 0 );
+        }
+    }
+    else
+    {
+        //we just 'multiply' by the Identity block
+        blas_xcopy( bs, X, 1, Y, 1);
+    }
 }
 
 
 //------------------------------------------------------------------------------
-void Meca::precondition(const real* X, real* Y) const
+/**
+ The solution of the previous call to solve() is still in vSOL, ordered according
+ to the indices that the Mecables had at that time, which are known from
+ Mecable::oldIndex(). The values are copied to their new location, using vTMP.
+ The Mecables that are new, or which have changed their number of points,
+ start from zero.
+ */
+unsigned Meca::warmStart()
 {
+    unsigned res = 0;
+    
     for ( Mecable ** mci = objs.begin(); mci < objs.end(); ++mci )
     {
         Mecable const* mec = *mci;
-        const unsigned bs = DIM * mec->nbPoints();
-        const index_type indx = DIM * mec->matIndex();
-        if ( mec->useBlock() )
+        const unsigned nbp = mec->nbPoints();
+        real * dst = vTMP + DIM * mec->matIndex();
+        if ( nbp == mec->oldPoints()  &&  mec->oldIndex() + nbp <= nbPtsOld )
         {
-            //we use the block that was calculated
-            blas_xgemv('N', bs, bs, 1.0, mec->block(), bs, X+indx, 1, 0.0, Y+indx, 1);
+            blas_xcopy(DIM*nbp, vSOL+DIM*mec->oldIndex(), 1, dst, 1);
+            res += nbp;
         }
         else
+            blas_xzero(DIM*nbp, dst);
+    }
+    
+    blas_xcopy(DIM*nbPts, vTMP, 1, vSOL, 1);
+    return res;
+}
+
+
+//==========================================================================
+//======================   INDEPENDENT SUBSYSTEMS   ========================
+//==========================================================================
+#pragma mark -
+
+/**
+ The points connected by an element of mB or mC are joined, and the points
+ of a Mecable are always joined, since they are connected by internal forces.
+ All the allocated elements are considered, even if they are zero, such that
+ the multiplication of a subsystem never reads the vector of another subsystem.
+ The components are numbered in the order of their first Mecable.
+ */
+unsigned Meca::findComponents()
+{
+    const unsigned nbm = objs.size();
+    cmpRoot.resize(nbPts);
+    cmpMec.resize(nbm);
+    index_type * root = cmpRoot.addr();
+    
+    for ( unsigned m = 0; m < nbm; ++m )
+    {
+        const index_type inx = objs[m]->matIndex();
+        const index_type end = inx + objs[m]->nbPoints();
+        for ( index_type p = inx; p < end; ++p )
+            root[p] = inx;
+    }
+    
+    if ( use_mB )
+        mB.joinLines(root, 1);
+    if ( use_mC )
+        mC.joinLines(root, DIM);
+    
+    for ( unsigned m = 0; m < nbm; ++m )
+        cmpMec[m] = Matrix::findRoot(root, objs[m]->matIndex());
+    
+    /*
+     The root of a component is the first point of its first Mecable,
+     and root[] of this point is set to the index of the component
+     */
+    unsigned nbc = 0;
+    for ( unsigned m = 0; m < nbm; ++m )
+    {
+        const index_type r = cmpMec[m];
+        if ( r == objs[m]->matIndex() )
+            root[r] = nbc++;
+        cmpMec[m] = root[r];
+    }
+    
+    cmpStart.resize(nbc+1);
+    cmpPts.resize(nbc+1);
+    for ( unsigned c = 0; c <= nbc; ++c )
+    {
+        cmpStart[c] = 0;
+        cmpPts[c] = 0;
+    }
+    
+    // count, keeping the index of the component of each Mecable in root[]:
+    for ( unsigned m = 0; m < nbm; ++m )
+    {
+        const unsigned c = cmpMec[m];
+        root[m] = c;
+        ++cmpStart[c+1];
+        cmpPts[c+1] += objs[m]->nbPoints();
+    }
+    
+    for ( unsigned c = 0; c < nbc; ++c )
+    {
+        cmpStart[c+1] += cmpStart[c];
+        cmpPts[c+1] += cmpPts[c];
+    }
+    
+    // fill, using cmpStart[c] as a cursor for component c:
+    for ( unsigned m = 0; m < nbm; ++m )
+        cmpMec[cmpStart[root[m]]++] = m;
+    
+    // the cursors are now at the start of the next component:
+    for ( unsigned c = nbc; c > 0; --c )
+        cmpStart[c] = cmpStart[c-1];
+    cmpStart[0] = 0;
+    
+    nbComponents = nbc;
+    return nbc;
+}
+
+
+/// gives access to the vectors of a Subsystem, in memory shared by all subsystems
+class SliceAllocator
+{
+    real * mem;
+    size_t stride;
+    
+public:
+    
+    SliceAllocator(real * m, size_t s) : mem(m), stride(s) {}
+    
+    void allocate(size_t, unsigned) {}
+    
+    real * bind(unsigned i) { return mem + i * stride; }
+    
+    void relax() {}
+};
+
+
+/// Implementation of Solver::LinearOperator for one group of Mecables
+/**
+ The vectors of the subsystem are contiguous, and contain the points of its
+ Mecables in the order of cmpMec. They are copied to and from vectors indexed
+ as in Meca, to call Meca::multiply() for each Mecable.
+ Subsystems are disjoint, and can be solved concurrently.
+ */
+class Meca::Subsystem
+{
+public:
+    
+    Meca const*     meca;
+    unsigned const* mec;        ///< indices of the Mecables
+    unsigned        nbm;        ///< number of Mecables
+    unsigned        nbp;        ///< number of points
+    real *          gX;         ///< vector indexed as in Meca
+    real *          gY;         ///< vector indexed as in Meca
+    real *          rhs;        ///< right-hand side
+    real *          sol;        ///< solution
+    real *          work;       ///< first temporary vector of the solver
+    size_t          stride;     ///< distance between temporary vectors
+    bool            use_precond;
+    real            tolerance;
+    unsigned        iter;
+    real            resid;
+    bool            converged;
+    mutable double  applyTime;
+    
+    unsigned int size() const { return DIM * nbp; }
+    
+    /// copy the values of the Mecables from G to x
+    void gather(const real* G, real* x) const
+    {
+        for ( unsigned k = 0; k < nbm; ++k )
+        {
+            Mecable const* m = meca->objs[mec[k]];
+            const unsigned bs = DIM * m->nbPoints();
+            blas_xcopy(bs, G+DIM*m->matIndex(), 1, x, 1);
+            x += bs;
+        }
+    }
+    
+    /// copy the values of the Mecables from x to G
+    void scatter(const real* x, real* G) const
+    {
+        for ( unsigned k = 0; k < nbm; ++k )
+        {
+            Mecable const* m = meca->objs[mec[k]];
+            const unsigned bs = DIM * m->nbPoints();
+            blas_xcopy(bs, x, 1, G+DIM*m->matIndex(), 1);
+            x += bs;
+        }
+    }
+    
+    void multiply(const real* X, real* Y) const
+    {
+        scatter(X, gX);
+        for ( unsigned k = 0; k < nbm; ++k )
+            meca->multiply(gX, gY, mec[k], mec[k]+1);
+        gather(gY, Y);
+    }
+    
+    void precondition(const real* X, real* Y) const
+    {
+        double time = TicToc::milli_seconds();
+        for ( unsigned k = 0; k < nbm; ++k )
         {
-            //we just 'multiply' by the Identity block
-            blas_xcopy( bs, X+indx, 1, Y+indx, 1);
+            Mecable const* m = meca->objs[mec[k]];
+            meca->preconditionBlock(m, X, Y);
+            X += DIM * m->nbPoints();
+            Y += DIM * m->nbPoints();
         }
+        applyTime += TicToc::milli_seconds() - time;
+    }
+    
+    void solve()
+    {
+        SliceAllocator allocator(work, stride);
+        Solver::Monitor monitor(DIM*nbp, tolerance);
+        if ( use_precond )
+            Solver::BCGSP(*this, rhs, sol, monitor, allocator);
+        else
+            Solver::BCGS(*this, rhs, sol, monitor, allocator);
+        iter = monitor.iterations();
+        resid = monitor.residual();
+        converged = monitor.converged();
+    }
+    
+    /// used to sort by decreasing size
+    static int compareSize(const void * a, const void * b)
+    {
+        unsigned x = (*static_cast<Subsystem *const*>(a))->nbp;
+        unsigned y = (*static_cast<Subsystem *const*>(b))->nbp;
+        return ( x < y ) - ( y < x );
+    }
+};
+
+
+/**
+ The argument is an array of Subsystem*, terminated by a null pointer.
+ */
+void Meca::solveComponentsJob(void * arg, const unsigned rank, const unsigned nbt)
+{
+    Subsystem ** list = static_cast<Subsystem**>(arg);
+    unsigned cnt = 0;
+    while ( list[cnt] )
+        ++cnt;
+    for ( unsigned c = rank; c < cnt; c += nbt )
+        list[c]->solve();
+}
+
+
+/**
+ Solve the system of each component found by findComponents() separately,
+ with the residual threshold `tolerance`. The subsystems are sorted by decreasing
+ size, and distributed in turn over the threads of POOL.
+ The solutions are copied to vSOL only if all subsystems have converged,
+ and `iter` and `resid` are set to the maximum over all subsystems.
+ */
+bool Meca::solveComponents(const bool use_precond, const real tolerance, unsigned& iter, real& resid)
+{
+    const unsigned nbc = nbComponents;
+    
+    // 7 vectors for the solver, and rhs, sol, gX and gY:
+    static Solver::Allocator memory;
+    memory.allocate(DIM*nbPts, 11);
+    const size_t stride = memory.bind(1) - memory.bind(0);
+    
+    Subsystem * sub = new Subsystem[nbc];
+    Subsystem ** list = new Subsystem*[nbc+1];
+    
+    for ( unsigned c = 0; c < nbc; ++c )
+    {
+        Subsystem & S = sub[c];
+        const size_t off = DIM * cmpPts[c];
+        S.meca = this;
+        S.mec  = cmpMec.addr() + cmpStart[c];
+        S.nbm  = cmpStart[c+1] - cmpStart[c];
+        S.nbp  = cmpPts[c+1] - cmpPts[c];
+        S.work = memory.bind(0) + off;
+        S.stride = stride;
+        S.rhs  = memory.bind(7) + off;
+        S.sol  = memory.bind(8) + off;
+        S.gX   = memory.bind(9);
+        S.gY   = memory.bind(10);
+        S.use_precond = use_precond;
+        S.tolerance = tolerance;
+        S.iter = 0;
+        S.resid = 0;
+        S.converged = false;
+        S.applyTime = 0;
+        S.gather(vRHS, S.rhs);
+        S.gather(vSOL, S.sol);
+        list[c] = sub + c;
+    }
+    qsort(list, nbc, sizeof(Subsystem*), Subsystem::compareSize);
+    list[nbc] = 0;
+    
+    POOL.run(solveComponentsJob, list);
+    
+    bool res = true;
+    iter = 0;
+    resid = 0;
+    for ( unsigned c = 0; c < nbc; ++c )
+    {
+        Subsystem const& S = sub[c];
+        if ( S.iter > iter )  iter = S.iter;
+        if ( S.resid > resid ) resid = S.resid;
+        res &= S.converged;
+        precondApplyTime += S.applyTime;
+    }
+    
+    if ( res )
+    {
+        for ( unsigned c = 0; c < nbc; ++c )
+            sub[c].scatter(sub[c].sol, vSOL);
+    }
+    
+    delete[] list;
+    delete[] sub;
+    return res;
+}
+
+
+//==========================================================================
+//============================   SOLVER LOG   ==============================
+//==========================================================================
+#pragma mark -
+
+/// names of the values in a record, in the order used by solve()
+static const char * logFields[] = { "step", "size", "nnz_B", "nnz_C", "precond", "built",
+    "noise", "threshold", "iter", "residual", "subsystems",
+    "t_assembly", "t_forces", "t_build", "t_apply", "t_solve", "t_finish" };
+
+
+/**
+ In text mode, the names of the values are written first,
+ unless the file is appended and not empty.
+ */
+void Meca::openLog(SimulProp const* prop)
+{
+    if ( logFile )
+        fclose(logFile);
+    
+    logName = prop->solver_log;
+    logBinary = prop->solver_log_binary;
+    
+    const char * mode = logBinary ? "wb" : "w";
+    if ( prop->append_file )
+        mode = logBinary ? "ab" : "a";
+    
+    logFile = fopen(logName.c_str(), mode);
+    if ( !logFile )
+        throw InvalidParameter("could not open solver_log file `"+logName+"'");
+    
+    if ( !logBinary  &&  0 == ftell(logFile) )
+    {
+        const unsigned cnt = sizeof(logFields) / sizeof(char*);
+        for ( unsigned i = 0; i < cnt; ++i )
+            fprintf(logFile, i ? ", %s" : "%s", logFields[i]);
+        fprintf(logFile, "\n");
+    }
+}
+
+
+void Meca::writeLog(double const* rec, const unsigned cnt)
+{
+    assert_true( cnt == sizeof(logFields) / sizeof(char*) );
+    
+    if ( logBinary )
+        fwrite(rec, sizeof(double), cnt, logFile);
+    else
+    {
+        for ( unsigned i = 0; i < cnt; ++i )
+            fprintf(logFile, i ? ", %.6g" : "%.0f", rec[i]);
+        fprintf(logFile, "\n");
     }
 }
 
@@ -474,13 +1168,29 @@ void Meca::precondition(const real* X, real* Y) const
 void allocate(unsigned int s, real *& ptr, bool reset)
 {
     if ( ptr )
-        delete(ptr);
+        delete[] ptr;
     ptr = new real[s];
     if ( reset )
         blas_xzero(s, ptr);
 }
 
 
+/// allocate, keeping the first `cnt` values, and setting the others to zero
+void reallocate(unsigned int s, real *& ptr, unsigned int cnt)
+{
+    real * tmp = new real[s];
+    if ( ptr )
+    {
+        blas_xcopy(cnt, ptr, 1, tmp, 1);
+        delete[] ptr;
+    }
+    else
+        cnt = 0;
+    blas_xzero(s-cnt, tmp+cnt);
+    ptr = tmp;
+}
+
+
 /**
  Allocate and reset matrices and vectors necessary for Meca::solve(),
  copy coordinates of Mecables into vPTS[]
@@ -515,7 +1225,7 @@ void Meca::prepare(SimulProp const* prop)
         
         allocate(DIM*allocated, vBAS, 0);
         allocate(DIM*allocated, vPTS, 1);
-        allocate(DIM*allocated, vSOL, 1);
+        reallocate(DIM*allocated, vSOL, DIM*nbPtsOld);
         allocate(DIM*allocated, vRHS, 1);
         allocate(DIM*allocated, vFOR, 1);
         allocate(DIM*allocated, vTMP, 0);
@@ -534,6 +1244,8 @@ void Meca::prepare(SimulProp const* prop)
         mec->putPoints(vPTS+DIM*mec->matIndex());
         mec->prepareMecable();
     }
+    
+    prepareTime = TicToc::milli_seconds();
 }
 
 
@@ -595,9 +1307,17 @@ void Meca::computeForces()
  where, in both cases, Brown = sqrt(2*kT*dt*mobility) * Gaussian(0,1)
  Implicit integration is more robust.
  */
-void Meca::solve(SimulProp const* prop, const bool precondition)
+void Meca::solve(SimulProp const* prop, const int precondition)
 {
     assert_true( time_step == prop->time_step );
+    const double time0 = TicToc::milli_seconds();
+    
+    precondMode = precondition;
+    precondBuildTime = 0;
+    precondApplyTime = 0;
+    precondReuse = prop->precondition_reuse;
+    precondDrift = prop->precondition_drift;
+    precondBuilt = 0;
 
     if ( objs.size() == 0 )
         return;
@@ -632,11 +1352,15 @@ void Meca::solve(SimulProp const* prop, const bool precondition)
     
     real noiseLevel = INFINITY;
     
+    // draw all the Gaussian random numbers at once, in vTMP:
+    RNG.gauss_array(DIM*nbPts, vTMP);
+
     //add the Brownian contribution
     for ( Mecable ** mci = objs.begin(); mci < objs.end(); ++mci )
     {
         Mecable const * mec = *mci;
-        real th = mec->addBrownianForces( vFOR + DIM * mec->matIndex(), prop->kT/time_step );
+        const index_type indx = DIM * mec->matIndex();
+        real th = mec->addBrownianForces( vTMP+indx, prop->kT/time_step, vFOR+indx );
         if ( th < noiseLevel )
             noiseLevel = th;
     }
@@ -696,12 +1420,16 @@ void Meca::solve(SimulProp const* prop, const bool precondition)
      Choose the initial guess for the solution of the system (Xnew - Xold):
      we could use the solution at the previous step, or a vector of zeros.
      Using the previous solution could be advantageous if the speed were 
-     somehow continuous. However, the system is without inertia. In addition,
-     objects are considered in a random order to build the linear system, such
-     that the blocks from two consecutive iterations do not match.
-     Using zero for the initial guess seems a safe bet:
+     somehow continuous. However, the system is without inertia, and
+     objects are considered in a different order to build the linear system,
+     such that the previous solution must be reordered by warmStart().
+     Using zero for the initial guess seems a safe bet, and is the default:
      */
-    blas_xzero(DIM*nbPts, vSOL);
+    unsigned warm = 0;
+    if ( prop->warm_start )
+        warm = warmStart();
+    else
+        blas_xzero(DIM*nbPts, vSOL);
 
     /*
      We now solve the system MAT * vSOL = vRHS  by an iterative method:
@@ -729,15 +1457,45 @@ void Meca::solve(SimulProp const* prop, const bool precondition)
      This is the max limit that is set here to the number of iterations:
      */
     Solver::Monitor monitor(DIM*nbPts, prop->tolerance*noiseLevel);
+    unsigned nb_iter = 0;
+    real residual = 0;
 
     //------- call the iterative solver:
-    //@todo: we may not need to calculate the preconditioner at every step
     //std::cerr << "Solve: " << DIM*nbPts << "  " << residual_ask << std::endl;
 
-    if ( precondition  &&  0 == computePreconditionner() ) 
-        Solver::BCGSP(*this, vRHS, vSOL, monitor, allocator);
-    else
-        Solver::BCGS(*this, vRHS, vSOL, monitor, allocator);
+    const double time1 = TicToc::milli_seconds();
+    const bool use_precond = ( precondition  &&  0 == computePreconditionner() );
+    
+    /*
+     The independent subsystems can be solved separately, each with its own
+     number of iterations. If any of them fails, the entire system is solved.
+     */
+    bool split = false;
+    if ( prop->split_solve  &&  findComponents() > 1 )
+        split = solveComponents(use_precond, prop->tolerance*noiseLevel, nb_iter, residual);
+    
+    if ( !split )
+    {
+        if ( use_precond )
+            Solver::BCGSP(*this, vRHS, vSOL, monitor, allocator);
+        else
+            Solver::BCGS(*this, vRHS, vSOL, monitor, allocator);
+        nb_iter = monitor.iterations();
+        residual = monitor.residual();
+    }
+    
+    if ( use_precond )
+    {
+        /*
+         If all blocks were recalculated, the iteration count is the reference.
+         If the count increases substantially, the reused blocks are probably too old,
+         and they will all be recalculated at the next time step.
+         */
+        if ( precondBuilt == objs.size() )
+            precondIter = nb_iter;
+        else if ( nb_iter > 2 * precondIter + 2 )
+            precondRenew = true;
+    }
     
 #if ( 0 )
     std::cerr << "BCGS" << precondition << "  " << code;
@@ -746,7 +1504,7 @@ void Meca::solve(SimulProp const* prop, const bool precondition)
     
     //------- in case the solver did not converge, we try other methods:
     
-    if ( !monitor.converged() )
+    if ( !split  &&  !monitor.converged() )
     {
         MSG("Solver failed: precond %i flag %i, nb_iter %3i residual %.2e\n", 
             precondition, monitor.flag(), monitor.iterations(), monitor.residual());
@@ -757,9 +1515,16 @@ void Meca::solve(SimulProp const* prop, const bool precondition)
         //---reset tolerance and iteration counters:
         monitor.reset();
         
-        //---try the same method again:
+        //---try the same method again, with all blocks recalculated:
         if ( precondition )
+        {
+            if ( precondBuilt < objs.size() )
+            {
+                precondRenew = true;
+                computePreconditionner();
+            }
             Solver::BCGSP(*this, vRHS, vSOL, monitor, allocator);
+        }
         else
             Solver::BCGS(*this, vRHS, vSOL, monitor, allocator);
         
@@ -779,6 +1544,8 @@ void Meca::solve(SimulProp const* prop, const bool precondition)
                 Solver::BCGS(*this, vRHS, vSOL, monitor, allocator);
             }
             else {
+                precondMode = 1;
+                precondRenew = true;
                 if ( 0 == computePreconditionner() )
                     Solver::BCGSP(*this, vRHS, vSOL, monitor, allocator);
                 else
@@ -796,11 +1563,20 @@ void Meca::solve(SimulProp const* prop, const bool precondition)
                 return;
             }
         }
+        nb_iter = monitor.iterations();
+        residual = monitor.residual();
     }
     
+    const double time2 = TicToc::milli_seconds();
+    
     //add the solution of the system (=dPTS) to the points coordinates
     blas_xaxpy(DIM*nbPts, 1., vSOL, 1, vPTS, 1);
     
+    //record the location of the solution, for warmStart():
+    for ( Mecable ** mci = objs.begin(); mci < objs.end(); ++mci )
+        (*mci)->saveIndex();
+    nbPtsOld = nbPts;
+    
     
 #ifndef NDEBUG
     
@@ -840,8 +1616,34 @@ void Meca::solve(SimulProp const* prop, const bool precondition)
         MSG("Meca degree %i*%-5i", DIM, nbPts);
         if ( use_mB ) MSG(" iso: %s ", mB.what().c_str());
         if ( use_mC ) MSG(" mat: %s ", mC.what().c_str());
-        MSG(" precond %i  nb_iter %i  residual %.2e\n", precondition, monitor.iterations(), monitor.residual());
+        MSG(" precond %i  nb_iter %i  residual %.2e", precondition, nb_iter, residual);
+        if ( precondition )
+            MSG(" (built %u/%u blocks in %.3f ms, apply %.3f ms)", precondBuilt, objs.size(), precondBuildTime, precondApplyTime);
+        if ( prop->warm_start )
+            MSG(" warm %.0f%%", 100.0 * warm / nbPts);
+        if ( split )
+            MSG(" split %u", nbComponents);
+        MSG("\n");
+    }
+    
+    //record the work of the solver
+    if ( prop->solver_log.size() )
+    {
+        if ( !logFile  ||  logName != prop->solver_log  ||  logBinary != prop->solver_log_binary )
+            openLog(prop);
+        
+        const double time3 = TicToc::milli_seconds();
+        double rec[] = { (double)logStep, (double)(DIM*nbPts),
+            (double)( use_mB ? mB.nbNonZeroElements() : 0 ),
+            (double)( use_mC ? mC.nbNonZeroElements() : 0 ),
+            (double)( use_precond ? precondMode : 0 ), (double)precondBuilt,
+            noiseLevel, prop->tolerance*noiseLevel, (double)nb_iter, residual,
+            (double)( split ? nbComponents : 1 ),
+            time0 - prepareTime, time1 - time0, precondBuildTime, precondApplyTime,
+            time2 - time1 - precondBuildTime, time3 - time2 };
+        writeLog(rec, sizeof(rec) / sizeof(double));
     }
+    ++logStep;
 }
 
 
@@ -3,6 +3,7 @@
 #ifndef MECA_H
 #define MECA_H
 
+#include <string>
 #include "array.h"
 #include "bicgstab.h"
 #include "vector.h"
@@ -10,6 +11,11 @@
 #include "matsparse.h"
 #include "matsparsesym.h"
 #include "matsparsesym1.h"
+#include "matsparsesymblk.h"
+
+
+/// set to 1 to store the matrix mC with blocks of size DIM x DIM
+#define MECA_USES_BLOCK_MATRIX 0
 
 class Mecable;
 class PointExact;
@@ -89,11 +95,47 @@ private:
     /// total number of points in the system
     unsigned int    nbPts;
     
+    /// number of points in the system, when vSOL was last calculated
+    unsigned int    nbPtsOld;
+    
     /// size of the currently allocated memory
     unsigned int    allocated;
     
     /// max block size
     unsigned int    largestBlock;
+    
+    /// size of temporary memory needed by lapack_xgetri()
+    int             workSize;
+    
+    /// type of preconditionner: 1 = inverse of the blocks, 2 = LU factors of the blocks, 3 = banded blocks
+    int             precondMode;
+    
+    /// time spent building the preconditionner during the last solve (milli-seconds)
+    double          precondBuildTime;
+    
+    /// time spent applying the preconditionner during the last solve (milli-seconds)
+    mutable double  precondApplyTime;
+    
+    /// maximum number of time steps during which a block may be reused
+    unsigned        precondReuse;
+    
+    /// relative change in stiffness above which a block is recalculated
+    real            precondDrift;
+    
+    /// if true, all blocks will be recalculated at the next call to computePreconditionner()
+    bool            precondRenew;
+    
+    /// precondMode and time_step used to calculate the current blocks
+    int             precondModeOld;
+    
+    /// time step used to calculate the current blocks
+    real            precondTimeStep;
+    
+    /// number of iterations needed by the solver after all blocks were recalculated
+    unsigned        precondIter;
+    
+    /// number of blocks that were recalculated in the last solve
+    unsigned        precondBuilt;
 
     //--------------------------------------------------------------------------
     // Vectors of size DIM * nbPts
@@ -125,8 +167,13 @@ public:
     /** 
         For interactions which have different coefficients on the X, Y, Z subspaces,
         or which create interactions between two different subspaces.
+        With MECA_USES_BLOCK_MATRIX, the elements are stored by blocks of DIM x DIM.
     */
+#if MECA_USES_BLOCK_MATRIX
+    MatrixSparseSymmetricBlock  mC;
+#else
     MatrixSparseSymmetric1  mC;
+#endif
 
     /// base for force
     real&   base(index_type ix) { return vBAS[ix]; }
@@ -136,12 +183,36 @@ public:
     
 private:
 
+    /// arguments of the calculations distributed over the threads
+    struct Task
+    {
+        Meca const* meca;
+        const real* X;
+        real*       Y;
+        bool        rigidity;
+    };
+    
+    /// set [start, end[ as the Mecables attributed to thread `rank`, balancing the number of points
+    void  partition(unsigned rank, unsigned nbt, unsigned& start, unsigned& end) const;
+    
     /// Y is set as the DIM-duplicate of Y, and symmetrized
     void  duplicateMat(int ps, const real* X, real* Y) const;
     
     /// add the linear part of forces:  Y <- Y + ( mB + mC ) * X;
     void  addLinearForces(const real* X, real* Y, bool with_rigidity) const;
     
+    /// add the linear part of forces, for the points of the Mecables [start, end[
+    void  addLinearForces(const real* X, real* Y, bool with_rigidity, unsigned start, unsigned end) const;
+    
+    /// calculate the lines of Y = M*X corresponding to the Mecables [start, end[
+    void  multiply(const real* X, real* Y, unsigned start, unsigned end) const;
+    
+    /// call addLinearForces() for the Mecables attributed to one thread
+    static void addLinearForcesJob(void*, unsigned, unsigned);
+    
+    /// call multiply() for the Mecables attributed to one thread
+    static void multiplyJob(void*, unsigned, unsigned);
+    
     /// calculate the forces for all points: Y <- vBAS + ( mB + mC ) * X
     void  computeForces(const real* X, real* Y, bool with_rigidity) const;
     
@@ -150,12 +221,84 @@ private:
     
     /// extract the matrix diagonal block corresponding to a Mecable
     void  getBlockS(const Mecable *, real*) const;
+    
+    /// extract the band of the stiffness matrix corresponding to a Mecable
+    void  getBand(const Mecable *, real*, unsigned) const;
 
     /// allocate memory, compute preconditionner and return true if completed
     int   computePreconditionner();
     
     /// compute preconditionner using the provided temporary memory
-    int   computePreconditionner(Mecable*, int*, real*, int);
+    int   computePreconditionner(Mecable*, real*, int);
+    
+    /// compute the preconditionner blocks attributed to one thread
+    static void computePreconditionnerJob(void*, unsigned, unsigned);
+    
+    /// sum of the diagonal terms of mB and mC corresponding to a Mecable
+    real  blockStiffness(const Mecable *) const;
+    
+    /// true if the preconditionner block of the Mecable should be recalculated
+    bool  blockIsStale(const Mecable *, real stiffness) const;
+    
+    /// set vSOL from the solution of the previous time step, and return the number of points recovered
+    unsigned warmStart();
+    
+    /// apply the preconditionner block of one Mecable
+    void  preconditionBlock(Mecable const*, const real* X, real* Y) const;
+    
+    //--------------------------------------------------------------------------
+    // Independent subsystems
+    
+    /// linear operator restricted to one independent subsystem
+    class Subsystem;
+    
+    /// number of independent subsystems found by findComponents()
+    unsigned           nbComponents;
+    
+    /// union-find forest over the points, used by findComponents()
+    Array<index_type>  cmpRoot;
+    
+    /// the Mecables of component `c` are objs[cmpMec[n]] for cmpStart[c] <= n < cmpStart[c+1]
+    Array<unsigned>    cmpStart;
+    
+    /// index of the Mecables, ordered by component
+    Array<unsigned>    cmpMec;
+    
+    /// cmpPts[c] is the number of points in the components before `c`
+    Array<unsigned>    cmpPts;
+    
+    /// find the groups of Mecables that are not connected by mB or mC, and return their number
+    unsigned findComponents();
+    
+    /// solve the independent subsystems separately, and return true if they all converged
+    bool  solveComponents(bool use_precond, real tolerance, unsigned& iter, real& resid);
+    
+    /// solve the subsystems attributed to one thread
+    static void solveComponentsJob(void*, unsigned, unsigned);
+    
+    //--------------------------------------------------------------------------
+    // Record of the work of the solver, see SimulProp::solver_log
+    
+    /// file in which the records are written
+    FILE *             logFile;
+    
+    /// name of logFile
+    std::string        logName;
+    
+    /// if true, the records are written in binary format
+    bool               logBinary;
+    
+    /// number of calls to solve()
+    unsigned long      logStep;
+    
+    /// wall-time at the end of prepare()
+    double             prepareTime;
+    
+    /// open the file specified by SimulProp::solver_log
+    void  openLog(SimulProp const*);
+    
+    /// write one record of `cnt` values
+    void  writeLog(double const* rec, unsigned cnt);
     
 public:
     
@@ -163,6 +306,9 @@ public:
     /// constructor
     Meca();
     
+    /// destructor
+    ~Meca();
+    
     /// Clear list of Mecable
     void  clear();
     
@@ -302,7 +448,7 @@ public:
     void  prepare(SimulProp const*);
     
     /// Calculate motion of the system
-    void  solve(SimulProp const*, bool precondition);
+    void  solve(SimulProp const*, int precondition);
     
     /// calculate Forces on objects and Lagrange multipliers for Fiber, without thermal motion
     void  computeForces();
@@ -7,28 +7,42 @@
 #include "organizer.h"
 
 
-Mecable::Mecable() : mIndex(0), pBlock(0), pBlockSize(0), pBlockUse(false)
+Mecable::Mecable()
+: mIndex(0), mIndexOld(0), mPointsOld(0), pBlock(0), pPivot(0), pBlockSize(0), pPivotSize(0), pBlockUse(false),
+pBlockPoints(0), pBlockAge(0), pBlockStiffness(0)
 {
 }
 
 
-real* Mecable::allocateBlock(unsigned size)
+real* Mecable::allocateBlock(unsigned nbv, unsigned nbp)
 {
-    if ( size > pBlockSize )
+    if ( nbv > pBlockSize )
     {
         if ( pBlock )
             delete[] pBlock;
-        pBlock = 0;
         
         /*  The first time, we allocate exactly what is demanded.
         but if allocation is required again, we allocate with some margin,
         because it means that this object is probably growing. */
         if ( 0 == pBlockSize )
-            pBlockSize = size;
+            pBlockSize = nbv;
         else
-            pBlockSize = size + 4;
+            pBlockSize = nbv + nbv / 4;
         
-        pBlock = new real[ pBlockSize * pBlockSize ];
+        pBlock = new real[pBlockSize];
+    }
+    
+    if ( nbp > pPivotSize )
+    {
+        if ( pPivot )
+            delete[] pPivot;
+        
+        if ( 0 == pPivotSize )
+            pPivotSize = nbp;
+        else
+            pPivotSize = nbp + 4;
+        
+        pPivot = new int[pPivotSize];
     }
     return pBlock;
 }
@@ -38,5 +52,7 @@ Mecable::~Mecable()
 {
     if ( pBlock )
         delete[] pBlock;
+    if ( pPivot )
+        delete[] pPivot;
 }
 
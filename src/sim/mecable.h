@@ -28,15 +28,36 @@ private:
     /// index in the matrices and vectors using in Meca
     Matrix::index_type mIndex;
     
+    /// value of mIndex when the system was last solved
+    Matrix::index_type mIndexOld;
+    
+    /// number of points when the system was last solved
+    unsigned int  mPointsOld;
+    
     /// block matrix used to precondition
     real *        pBlock;
     
-    /// allocated size of pBlock
+    /// pivots of the LU factorization stored in pBlock
+    int *         pPivot;
+    
+    /// number of values allocated in pBlock
     unsigned int  pBlockSize;
     
+    /// number of values allocated in pPivot
+    unsigned int  pPivotSize;
+    
     /// flag for preconditionning
     bool          pBlockUse;
     
+    /// number of points of the object when pBlock was calculated
+    unsigned int  pBlockPoints;
+    
+    /// number of time steps since pBlock was calculated
+    unsigned int  pBlockAge;
+    
+    /// stiffness signature of the object when pBlock was calculated
+    real          pBlockStiffness;
+    
     ///\todo add Mecable copy constructor and copy assignment
     
     /// Disabled copy constructor
@@ -89,6 +110,15 @@ public:
      */
     Matrix::index_type matIndex() const { return mIndex; }
     
+    /// record matIndex() and nbPoints(), when the system has been solved
+    void          saveIndex()           { mIndexOld = mIndex; mPointsOld = nbPoints(); }
+    
+    /// value of matIndex() when the system was last solved
+    Matrix::index_type oldIndex() const { return mIndexOld; }
+    
+    /// number of points when the system was last solved, or zero
+    unsigned int  oldPoints()     const { return mPointsOld; }
+    
     
     /// Tell Meca to use preconditionning on this object or not
     bool          useBlock()      const { return pBlockUse; }
@@ -96,12 +126,33 @@ public:
     /// change preconditionning flag
     void          useBlock(bool b)      { pBlockUse = b; }
     
-    /// Allocate a block of the requested size
-    real *        allocateBlock(unsigned);
+    /// Allocate a square block of the requested size, and the associated pivots
+    real *        allocateBlock(unsigned bs) { return allocateBlock(bs*bs, bs); }
+    
+    /// Allocate memory to hold `nbv` values and `nbp` pivots
+    real *        allocateBlock(unsigned nbv, unsigned nbp);
 
     /// return allocated block
     real *        block()          const { return pBlock; }
     
+    /// return pivot array allocated with the block
+    int *         pivot()          const { return pPivot; }
+    
+    /// number of time steps since the block was calculated
+    unsigned int  blockAge()       const { return pBlockAge; }
+    
+    /// increment the age of the block
+    void          ageBlock()             { ++pBlockAge; }
+    
+    /// true if the block was calculated for a different number of points, or if it is not valid
+    bool          blockChanged()   const { return !pBlockUse || pBlockPoints != nbPoints(); }
+    
+    /// stiffness signature recorded when the block was calculated
+    real          blockStiffness() const { return pBlockStiffness; }
+    
+    /// record that the block was just calculated, with given stiffness signature
+    void          renewBlock(real s)     { pBlockAge = 0; pBlockPoints = nbPoints(); pBlockStiffness = s; }
+    
     //--------------------------------------------------------------------------
     /// Calculate the mobility coefficient
     virtual void  setDragCoefficient() = 0;
@@ -121,8 +172,8 @@ public:
      */
     virtual void  prepareMecable() = 0;
         
-    /// Add Brownian noise terms to a force vector (sc = kT / dt)
-    virtual real  addBrownianForces(real* rhs, real sc) const { return INFINITY; }
+    /// Add Brownian noise terms to a force vector (sc = kT / dt), from the Gaussian random numbers in rnd[]
+    virtual real  addBrownianForces(real const* rnd, real sc, real* rhs) const { return INFINITY; }
     
     //--------------------------------------------------------------------------
     
@@ -162,6 +213,29 @@ public:
     /** This is enabled by a keyword PROJECTION_DIFF in meca.cc */
     virtual void  addProjectionDiff(const real* X, real* Y) const {}
     
+    //--------------------------------------------------------------------------
+    
+    /// half-bandwidth in points of the banded preconditionner, or zero if it is not implemented
+    /**
+     A Mecable can be preconditionned with a band matrix if its internal forces,
+     addRigidity() and addProjectionDiff(), only couple points that are
+     less than bandWidth() apart. This is used if SimulProp::precondition == 3.
+     */
+    virtual unsigned bandWidth() const { return 0; }
+    
+    /// calculate the banded preconditionner, from the band of the stiffness matrix
+    /**
+     `band` holds the upper band of the symmetric stiffness matrix of size DIM*nbPoints(),
+     in LAPACK symmetric band storage, with kd = DIM*(bandWidth()+1)-1 super-diagonals:
+     element (i, j) with i <= j is stored at band[kd+i-j+(kd+1)*j].
+     The function should factorize the block I + sc * P * band, using block() and pivot(),
+     and return 0 if this succeeded.
+     */
+    virtual int   factorizeBand(real const* band, real sc) { return 1; }
+    
+    /// apply the banded preconditionner calculated by factorizeBand(): X <- inverse(block) * X
+    virtual void  solveBand(real* X) const {}
+    
     //--------------------------------------------------------------------------
     /// add the interactions (for example due to confinements)
     virtual void  setInteractions(Meca &) const {}
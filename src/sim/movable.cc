@@ -13,7 +13,6 @@
 #include "random.h"
 #include "space.h"
 #include "simul.h"
-extern Random RNG;
 
 /** The default implementation is invalid */
 void Movable::translate(Vector const&)
@@ -8,6 +8,8 @@
 #include "modulo.h"
 #include "space.h"
 #include "simul.h"
+#include <algorithm>
+#include <pthread.h>
 
 extern Modulo * modulo;
 
@@ -28,6 +30,8 @@ void ObjectSet::link(Object * obj)
 void ObjectSet::relink(Object * obj)
 {
     assert_true( obj->linked() );
+    if ( deferred )
+        return;
     obj->list()->pop(obj);
     link(obj);
 }
@@ -320,13 +324,92 @@ void ObjectSet::remove(ObjectList & objs)
 }
 
 
+/// lock protecting ObjectSet::doomed
+static pthread_mutex_t doomLock = PTHREAD_MUTEX_INITIALIZER;
+
+
+/**
+ If the links are deferred, the object is only recorded, since erase() may then
+ be called concurrently by several threads, and it is deleted by deferLinks(false).
+ */
 void ObjectSet::erase(Object * obj)
 {
+    if ( deferred )
+    {
+        pthread_mutex_lock(&doomLock);
+        doomed.push_back(obj);
+        pthread_mutex_unlock(&doomLock);
+        return;
+    }
     remove(obj);
     delete(obj);
 }
 
 
+/// order Objects by increasing Number
+static bool smallerNumber(Object const* a, Object const* b)
+{
+    return a->number() < b->number();
+}
+
+
+/**
+ While the links are deferred, relink() does nothing, and the objects
+ should be relinked later by the caller. The objects given to erase() are recorded,
+ and deleted in the order of their Number when the links are no longer deferred,
+ such that the result does not depend on the order in which erase() was called.
+ */
+void ObjectSet::deferLinks(bool d)
+{
+    deferred = d;
+    if ( !d  &&  doomed.size() )
+    {
+        std::sort(doomed.begin(), doomed.end(), smallerNumber);
+        for ( std::vector<Object*>::iterator i = doomed.begin(); i != doomed.end(); ++i )
+            erase(*i);
+        doomed.clear();
+    }
+}
+
+
+/**
+ The generators are used to step the sections of the lists on different threads,
+ such that the results do not depend on the number of threads.
+ */
+Random * ObjectSet::sectionRNG()
+{
+    if ( !sectionStreams )
+    {
+        sectionStreams = new Random[NB_SECTIONS];
+        for ( unsigned s = 0; s < NB_SECTIONS; ++s )
+            sectionStreams[s].seed(RNG.pint());
+    }
+    return sectionStreams;
+}
+
+
+/**
+ The sections are consecutive: section `s` is [ res[s], res[s+1] [, and res[cnt] = 0
+ */
+void ObjectSet::divideList(NodeList const& list, const unsigned cnt, Node * res[])
+{
+    const unsigned long num = list.size();
+    Node * n = list.first();
+    unsigned long i = 0;
+    for ( unsigned s = 0; s < cnt; ++s )
+    {
+        const unsigned long inx = ( num * s ) / cnt;
+        while ( i < inx )
+        {
+            n = n->next();
+            ++i;
+        }
+        res[s] = n;
+    }
+    res[cnt] = 0;
+}
+
+
 void ObjectSet::erase()
 {
     nodes.erase();
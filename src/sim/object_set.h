@@ -14,7 +14,6 @@ class Property;
 class PropertyList;
 class Glossary;
 class Simul;
-extern Random RNG;
 
 /// A set of Object
 /**
@@ -59,6 +58,24 @@ protected:
     /// a list used to store the objects temporarily while a state is imported
     NodeList          ice;
     
+    /// if true, relink() does nothing, and erase() postpones the deletion (see deferLinks())
+    bool              deferred;
+    
+    /// the objects given to erase() while `deferred` was set
+    std::vector<Object*> doomed;
+    
+    /// Random Number Generators of the sections, allocated by sectionRNG()
+    Random *          sectionStreams;
+    
+    /// number of sections of the lists that are stepped independently in parallel mode
+    static const unsigned NB_SECTIONS = 64;
+    
+    /// return NB_SECTIONS Random Number Generators, which are seeded from RNG on the first call
+    Random *          sectionRNG();
+    
+    /// divide `list` into `cnt` sections of similar sizes, setting the first Node of each section in `res[]`
+    static void       divideList(NodeList const& list, unsigned cnt, Node * res[]);
+    
     /// remove all nodes in the list from the inventory
     void              forget(NodeList&);
     
@@ -93,10 +110,10 @@ protected:
 public:
     
     /// creator
-    ObjectSet(Simul& s) : nodes(this), simul(s), ice(0) { }
+    ObjectSet(Simul& s) : nodes(this), simul(s), ice(0), deferred(false), sectionStreams(0) { }
     
     /// destructor
-    virtual ~ObjectSet() { erase(); }    
+    virtual ~ObjectSet() { erase(); delete[] sectionStreams; }
     
     //--------------------------
     
@@ -140,6 +157,9 @@ public:
 
     /// remove Object, and delete it
     void               erase(Object *);
+    
+    /// if true, relink() and erase() are postponed, such that the list is not modified
+    void               deferLinks(bool);
 
     /// delete all Objects in list and forget all serial numbers
     virtual void       erase();
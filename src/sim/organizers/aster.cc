@@ -15,7 +15,6 @@
 #include "glossary.h"
 #include "simul.h"
 #include "meca.h"
-extern Random RNG;
 
 extern bool functionKey[];
 
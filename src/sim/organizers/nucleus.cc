@@ -13,7 +13,6 @@
 #include "bundle.h"
 #include "meca.h"
 
-extern Random RNG;
 
 
 void Nucleus::step()
@@ -7,14 +7,20 @@
 #include "modulo.h"
 #include "space.h"
 #include "meca.h"
+#include "fiber.h"
+#include "thread_pool.h"
+#include <cstdlib>
 
 extern Modulo const* modulo;
 
 //------------------------------------------------------------------------------
 
 PointGrid::PointGrid()
-: max_diameter(0)
+: max_diameter(0), mSkin(0), nbUpdates(0), jobParam(0), nbSections(0)
 {
+#if POINT_GRID_SPARSE
+    gridRows = 0;
+#endif
 }
 
 
@@ -62,6 +68,10 @@ void PointGrid::setGrid(Space const* space, Modulo const* modulo, real min_step)
 
     //The maximum allowed diameter of particles is half the minimum cell width
     max_diameter = mGrid.minimumWidth(1);
+    
+    //the pairs must be recalculated on the new grid
+    mRefs.clear();
+    mIds.clear();
 
     //report the grid size used
     MSG(5, "PointGrid set with %i cells:", mGrid.nbCells());
@@ -79,40 +89,77 @@ void PointGrid::setGrid(Space const* space, Modulo const* modulo, real min_step)
 
 
 
-void PointGrid::add(const PointExact & p, real rd) const
+void PointGrid::setSkin(real s)
+{
+    if ( s != mSkin )
+    {
+        mSkin = s;
+        mPoints.clear();
+        mLoci.clear();
+        mRefs.clear();
+        mIds.clear();
+        pairsPP.clear();
+        pairsPL.clear();
+        pairsLL.clear();
+        mGrid.clear();
+    }
+}
+
+
+void PointGrid::clear()
+{
+    if ( mSkin > 0 )
+    {
+        mPoints.clear();
+        mLoci.clear();
+    }
+    else
+        mGrid.clear();
+}
+
+
+void PointGrid::add(const PointExact & p, real rd)
 {
     Vector w = p.pos();
-    point_list(w).new_val().set(p, rd, w);
+    if ( mSkin > 0 )
+        mPoints.new_val().set(p, rd, w);
+    else
+        point_list(w).new_val().set(p, rd, w);
     
 #if ( CHECK_RANGE )
     //we check that the grid would correctly detect collision of two particles
-    if ( max_diameter < 2 * rd )
+    if ( max_diameter < 2 * rd + mSkin )
     {
         std::ostringstream oss;
         oss << "simul:steric_max_range is too short" << std::endl;
-        oss << PREF << "steric_max_range should be greater than 2 * particle-radius" << std::endl;
-        oss << PREF << "= " << 2 * rd << " for some particles" << std::endl;
+        oss << PREF << "steric_max_range should be greater than 2 * particle-radius + steric_skin" << std::endl;
+        oss << PREF << "= " << 2 * rd + mSkin << " for some particles" << std::endl;
         throw InvalidParameter(oss.str());
     }
 #endif
 }
 
 
-void PointGrid::add(const FiberLocus & p, real rd, real rg) const
+void PointGrid::add(const FiberLocus & p, real rd, real rg)
 {
-    //we use the middle of the segment (interpolation coefficient is ignored)
-    Vector w = p.center();
-    locus_list(w).new_val().set(p, rd, rg);
+    if ( mSkin > 0 )
+        mLoci.new_val().set(p, rd, rg);
+    else
+    {
+        //we use the middle of the segment (interpolation coefficient is ignored)
+        Vector w = p.center();
+        locus_list(w).new_val().set(p, rd, rg);
+    }
     
 #if ( CHECK_RANGE )
     //we check that the grid would correctly detect collision of two segments
     //along the diagonal, which corresponds to the worst-case scenario
-    real diag = sqrt( p.len() * p.len() + rg * rg );
+    real diag = sqrt( p.len() * p.len() + ( rg + mSkin ) * ( rg + mSkin ) );
     if ( max_diameter < diag )
     {
         std::ostringstream oss;
         oss << "simul:steric_max_range is too short" << std::endl;
-        oss << PREF << "steric_max_range should be greater than sqrt( sqr(segment_length) + 4*sqr(range) )" << std::endl;
+        oss << PREF << "steric_max_range should be greater than sqrt( sqr(segment_length) + 4*sqr(range+steric_skin/2) )" << std::endl;
         oss << PREF << "where normally segment_length ~ 4/3 segmentation" << std::endl;
         oss << PREF << "= " << diag << " for some fibers" << std::endl;
         throw InvalidParameter(oss.str());
@@ -132,7 +179,8 @@ void PointGrid::add(const FiberLocus & p, real rd, real rg) const
  The force is applied if the objects are closer than the
  sum of their radiuses.
  */
-void PointGrid::checkPP(Meca& meca, PointGridParam const& pam, FatPoint const& aa, FatPoint const& bb) const
+template < typename MECA >
+void PointGrid::checkPP(MECA& meca, PointGridParam const& pam, FatPoint const& aa, FatPoint const& bb) const
 {
     const real len = aa.radius + bb.radius;
     Vector vab = bb.pos - aa.pos;
@@ -151,7 +199,8 @@ void PointGrid::checkPP(Meca& meca, PointGridParam const& pam, FatPoint const& a
  
  The force is applied if the objects are closer to the sum of their radiuses.
  */
-void PointGrid::checkPL(Meca& meca, PointGridParam const& pam, FatPoint const& aa, FatLocus const& bb) const
+template < typename MECA >
+void PointGrid::checkPL(MECA& meca, PointGridParam const& pam, FatPoint const& aa, FatLocus const& bb) const
 {
     const real len = aa.radius + bb.radius;
     
@@ -203,7 +252,8 @@ void PointGrid::checkPL(Meca& meca, PointGridParam const& pam, FatPoint const& a
  
  The interaction is applied only if the model-point projects 'inside' the segment.
  */
-void PointGrid::checkLL1(Meca& meca, PointGridParam const& pam, FatLocus const& aa, FatLocus const& bb) const
+template < typename MECA >
+void PointGrid::checkLL1(MECA& meca, PointGridParam const& pam, FatLocus const& aa, FatLocus const& bb) const
 {
     const real ran = aa.range + bb.radius;
     
@@ -277,7 +327,8 @@ void PointGrid::checkLL1(Meca& meca, PointGridParam const& pam, FatLocus const&
  
  The interaction is applied only if the model-point projects 'inside' the segment.
  */
-void PointGrid::checkLL2(Meca& meca, PointGridParam const& pam, FatLocus const& aa, FatLocus const& bb) const
+template < typename MECA >
+void PointGrid::checkLL2(MECA& meca, PointGridParam const& pam, FatLocus const& aa, FatLocus const& bb) const
 {
     const real ran = aa.range + bb.radius;
     
@@ -356,7 +407,8 @@ void PointGrid::checkLL2(Meca& meca, PointGridParam const& pam, FatLocus const&
  This is used to check two FiberLocus, that each represent a segment of a Fiber.
  The segments are tested for intersection in 3D.
  */
-void PointGrid::checkLL(Meca& meca, PointGridParam const& pam, FatLocus const& aa, FatLocus const& bb) const
+template < typename MECA >
+void PointGrid::checkLL(MECA& meca, PointGridParam const& pam, FatLocus const& aa, FatLocus const& bb) const
 {
     checkLL1(meca, pam, aa, bb);
     
@@ -395,66 +447,626 @@ void PointGrid::checkLL(Meca& meca, PointGridParam const& pam, FatLocus const& a
 #pragma mark -
 
 
+/// use AVX instructions to calculate the distances between the objects, 4 at a time
+#if defined(__AVX__) && !defined(REAL_IS_FLOAT)
+#  define POINT_GRID_USES_AVX 1
+#  include <immintrin.h>
+#else
+#  define POINT_GRID_USES_AVX 0
+#endif
+
+/// use SSE3 instructions to calculate the distances between the objects, 2 at a time
+#if !POINT_GRID_USES_AVX && defined(__SSE3__) && !defined(REAL_IS_FLOAT)
+#  define POINT_GRID_USES_INTEL_SSE3 1
+#  include <pmmintrin.h>
+#else
+#  define POINT_GRID_USES_INTEL_SSE3 0
+#endif
+
+/// number of objects processed together by packedDistances()
+#if POINT_GRID_USES_AVX
+static const unsigned PACK = 4;
+#else
+static const unsigned PACK = 2;
+#endif
+
+
 /**
- Check interactions between the FatPoints contained in Pane `pan1`, and `pan2`.
+ Store the coordinates of the centers of the objects of the cell, and their reach,
+ such that two objects cannot interact if the distance between their centers is
+ greater than the sum of their reach.
+ For a segment, the reach is its range plus its half-length.
+ 
+ `buf` will contain ( X, Y, Z, reach ) for `m` objects, FatPoints first and then FatLocus,
+ with `m` a multiple of PACK and greater or equal to the number of objects.
+ @returns m
  */
-void  PointGrid::setInteractions(Meca& meca, PointGridParam const& pam) const
+unsigned PointGrid::packCell(std::vector<real>& buf, PointGridCell const& cell)
 {
-    assert_true(pam.stiff_push >= 0);
-    assert_true(pam.stiff_pull >= 0);
+    FatPointList const& pts = cell.point_pane;
+    FatLocusList const& los = cell.locus_pane;
+    const unsigned n = pts.size() + los.size();
+    const unsigned m = ( n + PACK - 1 ) & ~( PACK - 1 );
+    
+    buf.resize(( DIM + 1 ) * m);
+    
+    unsigned i = 0;
+    for ( FatPoint const* p = pts.begin(); p < pts.end(); ++p, ++i )
+    {
+        for ( int d = 0; d < DIM; ++d )
+            buf[d*m+i] = p->pos[d];
+        buf[DIM*m+i] = p->radius;
+    }
+    
+    for ( FatLocus const* l = los.begin(); l < los.end(); ++l, ++i )
+    {
+        Vector c = l->fl.center();
+        for ( int d = 0; d < DIM; ++d )
+            buf[d*m+i] = c[d];
+        buf[DIM*m+i] = l->range + 0.5 * l->fl.diff().norm();
+    }
+    
+    // padding, which is ignored:
+    for ( int d = 0; d <= DIM; ++d )
+        for ( unsigned j = n; j < m; ++j )
+            buf[d*m+j] = 0;
 
-    // scan all cells to examine each pair of particles:
-    for ( unsigned indx = 0; indx < mGrid.nbCells(); ++indx )
+    return m;
+}
+
+
+/**
+ Calculate dis[i] = distance(w, X[i])^2 - ( r + reach[i] )^2, for objects [start, n[ stored in `buf`
+ by packCell(), such that the objects can only interact if dis[i] < 0.
+ With AVX or SSE3, the objects are processed by groups of PACK,
+ starting from an index that is a multiple of PACK.
+ */
+static void packedDistances(real const* buf, unsigned start, unsigned n, unsigned m,
+                            Vector const& w, real r, real* dis)
+{
+#if POINT_GRID_USES_AVX
+    if ( !modulo )
+    {
+        __m256d wx = _mm256_set1_pd(w.XX);
+#if ( DIM > 1 )
+        __m256d wy = _mm256_set1_pd(w.YY);
+#endif
+#if ( DIM > 2 )
+        __m256d wz = _mm256_set1_pd(w.ZZ);
+#endif
+        __m256d rr = _mm256_set1_pd(r);
+        
+        for ( unsigned i = start & ~3U; i < n; i += 4 )
+        {
+            __m256d a = _mm256_sub_pd(wx, _mm256_loadu_pd(buf+i));
+            __m256d d = _mm256_mul_pd(a, a);
+#if ( DIM > 1 )
+            a = _mm256_sub_pd(wy, _mm256_loadu_pd(buf+m+i));
+            d = _mm256_add_pd(d, _mm256_mul_pd(a, a));
+#endif
+#if ( DIM > 2 )
+            a = _mm256_sub_pd(wz, _mm256_loadu_pd(buf+2*m+i));
+            d = _mm256_add_pd(d, _mm256_mul_pd(a, a));
+#endif
+            __m256d t = _mm256_add_pd(rr, _mm256_loadu_pd(buf+DIM*m+i));
+            _mm256_storeu_pd(dis+i, _mm256_sub_pd(d, _mm256_mul_pd(t, t)));
+        }
+        return;
+    }
+#elif POINT_GRID_USES_INTEL_SSE3
+    if ( !modulo )
+    {
+        __m128d wx = _mm_set1_pd(w.XX);
+#if ( DIM > 1 )
+        __m128d wy = _mm_set1_pd(w.YY);
+#endif
+#if ( DIM > 2 )
+        __m128d wz = _mm_set1_pd(w.ZZ);
+#endif
+        __m128d rr = _mm_set1_pd(r);
+        
+        for ( unsigned i = start & ~1U; i < n; i += 2 )
+        {
+            __m128d a = _mm_sub_pd(wx, _mm_load_pd(buf+i));
+            __m128d d = _mm_mul_pd(a, a);
+#if ( DIM > 1 )
+            a = _mm_sub_pd(wy, _mm_load_pd(buf+m+i));
+            d = _mm_add_pd(d, _mm_mul_pd(a, a));
+#endif
+#if ( DIM > 2 )
+            a = _mm_sub_pd(wz, _mm_load_pd(buf+2*m+i));
+            d = _mm_add_pd(d, _mm_mul_pd(a, a));
+#endif
+            __m128d t = _mm_add_pd(rr, _mm_load_pd(buf+DIM*m+i));
+            _mm_store_pd(dis+i, _mm_sub_pd(d, _mm_mul_pd(t, t)));
+        }
+        return;
+    }
+#endif
+    
+    for ( unsigned i = start; i < n; ++i )
     {
+        Vector a;
+        for ( int d = 0; d < DIM; ++d )
+            a[d] = w[d] - buf[d*m+i];
+        
+        if ( modulo )
+            modulo->fold(a);
+        
+        const real t = r + buf[DIM*m+i];
+        dis[i] = a.normSqr() - t * t;
+    }
+}
+
+
+/**
+ Check object `i` of cell `a` against object `k` of cell `b`,
+ where the FatPoints are numbered first, followed by the FatLocus.
+ */
+template < typename MECA >
+void PointGrid::checkObjects(MECA& meca, PointGridParam const& pam,
+                             PointGridCell const& a, unsigned i,
+                             PointGridCell const& b, unsigned k) const
+{
+    const unsigned na = a.point_pane.size();
+    const unsigned nb = b.point_pane.size();
+    
+    if ( i < na )
+    {
+        if ( k < nb )
+            checkPP(meca, pam, a.point_pane[i], b.point_pane[k]);
+        else
+            checkPL(meca, pam, a.point_pane[i], b.locus_pane[k-nb]);
+    }
+    else
+    {
+        if ( k < nb )
+            checkPL(meca, pam, b.point_pane[k], a.locus_pane[i-na]);
+        else
+            checkLL(meca, pam, a.locus_pane[i-na], b.locus_pane[k-nb]);
+    }
+}
+
+
+/**
+ Check interactions between the FatPoints contained in the sections [start, end[,
+ and the FatPoints located in the same cell or in a neighboring cell.
+ The sections are set by setSections().
+ 
+ The centers of the objects of each cell are packed in a buffer (see packCell()),
+ to calculate the distances between one object and all the objects of a cell together.
+ Only the pairs that are within reach are then checked in details.
+ The pairs are checked in the same order as if all pairs were considered.
+ */
+template < typename MECA >
+void PointGrid::checkCells(MECA& meca, PointGridParam const& pam, const unsigned start, const unsigned end) const
+{
+    std::vector<real> baseBuf, sideBuf, dis;
+    
+    // scan the cells to examine each pair of particles:
+    for ( unsigned s = start; s < end; ++s )
+    for ( unsigned indx = sectionInf(s); indx < sectionSup(s); ++indx )
+    {
+        PointGridCell const* base = mGrid.find(indx);
+        
+        // skip cells that were not allocated:
+        if ( !base )
+            continue;
+        
+        const unsigned nB = base->point_pane.size() + base->locus_pane.size();
+        
+        if ( nB == 0 )
+            continue;
+        
         int * region;
         int nr = mGrid.getRegion(region, indx);
         assert_true(region[0] == 0);
+        
+        const unsigned mB = packCell(baseBuf, *base);
+        dis.resize(mB);
+        
         /*
          We should consider each pair of objects (ii, jj) only once.
          If we are handling the list of particles that are in the same cell (reg==0),
          then index jj starts at ii+1. If however, we handle lists from different cells,
          then all possible values of jj are considered.
          */
+        for ( unsigned ii = 0; ii < nB; ++ii )
+        {
+            Vector w;
+            for ( int d = 0; d < DIM; ++d )
+                w[d] = baseBuf[d*mB+ii];
+            
+            packedDistances(&baseBuf[0], ii+1, nB, mB, w, baseBuf[DIM*mB+ii], &dis[0]);
+            
+            for ( unsigned jj = ii+1; jj < nB; ++jj )
+                if ( dis[jj] < 0 )
+                    checkObjects(meca, pam, *base, ii, *base, jj);
+        }
+        
+        for ( int reg = 1; reg < nr; ++reg )
+        {
+            PointGridCell const* side = mGrid.find(indx+region[reg]);
+            
+            if ( !side )
+                continue;
+            
+            const unsigned nS = side->point_pane.size() + side->locus_pane.size();
+            
+            if ( nS == 0 )
+                continue;
+            
+            const unsigned mS = packCell(sideBuf, *side);
+            dis.resize(std::max(mB, mS));
+            
+            for ( unsigned ii = 0; ii < nB; ++ii )
+            {
+                Vector w;
+                for ( int d = 0; d < DIM; ++d )
+                    w[d] = baseBuf[d*mB+ii];
+                
+                packedDistances(&sideBuf[0], 0, nS, mS, w, baseBuf[DIM*mB+ii], &dis[0]);
+                
+                for ( unsigned jj = 0; jj < nS; ++jj )
+                    if ( dis[jj] < 0 )
+                        checkObjects(meca, pam, *base, ii, *side, jj);
+            }
+        }
+    }
+}
+
+
+/**
+ Check the recorded pairs, numbered from 0 to nbPairs(), where
+ the pairs of FatPoint come first, followed by the pairs of FatPoint and FatLocus,
+ and the pairs of FatLocus.
+ */
+template < typename MECA >
+void PointGrid::checkPairs(MECA& meca, PointGridParam const& pam, unsigned start, unsigned end) const
+{
+    const unsigned nPP = pairsPP.size();
+    const unsigned nPL = pairsPL.size();
+    
+    for ( unsigned n = start; n < std::min(end, nPP); ++n )
+        checkPP(meca, pam, mPoints[pairsPP[n].a], mPoints[pairsPP[n].b]);
+    
+    start = std::max(start, nPP) - nPP;
+    end = std::max(end, nPP) - nPP;
+    
+    for ( unsigned n = start; n < std::min(end, nPL); ++n )
+        checkPL(meca, pam, mPoints[pairsPL[n].a], mLoci[pairsPL[n].b]);
+    
+    start = std::max(start, nPL) - nPL;
+    end = std::max(end, nPL) - nPL;
+    
+    for ( unsigned n = start; n < std::min(end, pairsLL.size()); ++n )
+        checkLL(meca, pam, mLoci[pairsLL[n].a], mLoci[pairsLL[n].b]);
+}
+
+
+void PointGridBuffer::apply(Meca& meca) const
+{
+    for ( Link const* k = links.begin(); k < links.end(); ++k )
+    {
+        switch ( k->type )
+        {
+            case LONG_LINK:
+                meca.interLongLink(k->ea, k->eb, k->len, k->weight);
+                break;
+            case SIDE_SLIDING_LINK:
+                meca.interSideSlidingLink(k->ia, k->eb, k->len, k->weight);
+                break;
+            case SIDE_SLIDING_LINK2:
+                meca.interSideSlidingLink(k->ia, k->ib, k->len, k->weight);
+                break;
+        }
+    }
+}
+
+
+void PointGrid::checkJob(void * arg, unsigned rank, unsigned nbt)
+{
+    PointGrid * pg = static_cast<PointGrid*>(arg);
+    PointGridBuffer & buf = pg->buffers[rank];
+    
+    unsigned start, end;
+    if ( pg->mSkin > 0 )
+    {
+        ThreadPool::partition(pg->nbPairs(), rank, nbt, start, end);
+        pg->checkPairs(buf, *pg->jobParam, start, end);
+    }
+    else
+    {
+        ThreadPool::partition(pg->nbSections, rank, nbt, start, end);
+        pg->checkCells(buf, *pg->jobParam, start, end);
+    }
+}
+
+
+/**
+ The cells (or the pairs) are divided in contiguous ranges, that are checked by different threads.
+ The interactions are recorded in one PointGridBuffer per thread, without modifying Meca.
+ Entering the buffers in the order of the threads gives the same sequence of
+ interactions as a serial calculation, and the results are thus independent
+ of the number of threads.
+ */
+void PointGrid::setInteractionsParallel(Meca& meca, PointGridParam const& pam)
+{
+    buffers.resize(POOL.size());
+    for ( unsigned t = 0; t < buffers.size(); ++t )
+        buffers[t].clear();
+    
+    jobParam = &pam;
+    POOL.run(checkJob, this);
+    
+    for ( unsigned t = 0; t < buffers.size(); ++t )
+        buffers[t].apply(meca);
+}
+
+
+/**
+ Check interactions between all pairs of FatPoints that may overlap.
+ */
+void  PointGrid::setInteractions(Meca& meca, PointGridParam const& pam)
+{
+    assert_true(pam.stiff_push >= 0);
+    assert_true(pam.stiff_pull >= 0);
+    
+    if ( mSkin > 0 )
+    {
+        sortLists();
+        if ( needUpdate() )
+            updatePairs();
+    }
+    else
+        setSections();
+    
+    if ( POOL.size() > 1 )
+        setInteractionsParallel(meca, pam);
+    else if ( mSkin > 0 )
+        checkPairs(meca, pam, 0, nbPairs());
+    else
+        checkCells(meca, pam, 0, nbSections);
+}
+
+
+/**
+ With POINT_GRID_SPARSE, each section is a row of cells that was allocated,
+ such that the time does not depend on the number of empty cells.
+ Otherwise each section is a single cell of the grid.
+ In both cases, visiting the sections in order visits the cells in increasing order.
+ */
+void PointGrid::setSections()
+{
+#if POINT_GRID_SPARSE
+    nbSections = mGrid.sortedRows(gridRows);
+#else
+    nbSections = mGrid.nbCells();
+#endif
+}
+
+
+//------------------------------------------------------------------------------
+#pragma mark - Neighbour lists
+
+bool PointGrid::nearPP(FatPoint const& aa, FatPoint const& bb) const
+{
+    const real ran = aa.radius + bb.radius + mSkin;
+    Vector vab = bb.pos - aa.pos;
+    
+    if ( modulo )
+        modulo->fold(vab);
+    
+    return vab.normSqr() < ran*ran;
+}
+
+
+bool PointGrid::nearPL(FatPoint const& aa, FatLocus const& bb) const
+{
+    const real ran = aa.radius + bb.radius + mSkin + 0.5 * bb.fl.len();
+    Vector vab = bb.fl.center() - aa.pos;
+    
+    if ( modulo )
+        modulo->fold(vab);
+    
+    return vab.normSqr() < ran*ran;
+}
+
+
+/**
+ The distance between the centers of the segments, minus their half-lengths,
+ is a lower bound of the distance between any of their points.
+ The pairs are recorded if this distance is less than their range extended by the skin,
+ which is conservative as long as no point moves by more than half the skin.
+ */
+bool PointGrid::nearLL(FatLocus const& aa, FatLocus const& bb) const
+{
+    const real ran = std::max(aa.range+bb.radius, aa.radius+bb.range) + mSkin + 0.5 * ( aa.fl.len() + bb.fl.len() );
+    Vector vab = bb.fl.center() - aa.fl.center();
+    
+    if ( modulo )
+        modulo->fold(vab);
+    
+    return vab.normSqr() < ran*ran;
+}
+
+
+/// function for qsort: orders FatPoint by Mecable and index of the model-point
+static int compareFatPoint(const void * A, const void * B)
+{
+    PointExact const& a = static_cast<FatPoint const*>(A)->pe;
+    PointExact const& b = static_cast<FatPoint const*>(B)->pe;
+    
+    if ( a.mecable() != b.mecable() )
+    {
+        if ( a.mecable()->tag() != b.mecable()->tag() )
+            return ( a.mecable()->tag() < b.mecable()->tag() ) ? -1 : 1;
+        return ( a.mecable()->number() < b.mecable()->number() ) ? -1 : 1;
+    }
+    return ( a.point() > b.point() ) - ( a.point() < b.point() );
+}
+
+
+/// function for qsort: orders FatLocus by Fiber and index of the segment
+static int compareFatLocus(const void * A, const void * B)
+{
+    FiberLocus const& a = static_cast<FatLocus const*>(A)->fl;
+    FiberLocus const& b = static_cast<FatLocus const*>(B)->fl;
+    
+    if ( a.fiber() != b.fiber() )
+        return ( a.fiber()->number() < b.fiber()->number() ) ? -1 : 1;
+    return ( a.point() > b.point() ) - ( a.point() < b.point() );
+}
+
+
+/**
+ Since the lists of objects are mixed at every time step in Simul,
+ the FatPoint and FatLocus are first sorted, such that the same objects
+ always occupy the same positions in the lists.
+ */
+void PointGrid::sortLists()
+{
+    qsort(mPoints.addr(), mPoints.size(), sizeof(FatPoint), &compareFatPoint);
+    qsort(mLoci.addr(), mLoci.size(), sizeof(FatLocus), &compareFatLocus);
+}
+
+
+/**
+ The pairs must be recalculated if objects were added or removed,
+ or if any point has moved by more than half the skin.
+ The pairs are indices in the sorted lists, and the identity of each entry is
+ also compared, since these indices can shift while the total count is unchanged,
+ for example if a Fiber gains a segment while another one loses a segment.
+ */
+bool PointGrid::needUpdate() const
+{
+    if ( mIds.size() != mPoints.size() + mLoci.size() )
+        return true;
+    
+    const real lim = 0.25 * mSkin * mSkin;
+    Vector const* ref = mRefs.begin();
+    Ident const* idt = mIds.begin();
+    
+    for ( FatPoint const* ii = mPoints.begin(); ii < mPoints.end(); ++ii, ++ref, ++idt )
+    {
+        if ( *idt != Ident(ii->pe.mecable(), ii->pe.point()) )
+            return true;
+        if ( ( ii->pos - *ref ).normSqr() > lim )
+            return true;
+    }
+    
+    for ( FatLocus const* ii = mLoci.begin(); ii < mLoci.end(); ++ii, ref += 2, ++idt )
+    {
+        if ( *idt != Ident(ii->fl.fiber(), ii->fl.point()) )
+            return true;
+        if ( ( ii->fl.pos1() - ref[0] ).normSqr() > lim )
+            return true;
+        if ( ( ii->fl.pos2() - ref[1] ).normSqr() > lim )
+            return true;
+    }
+    
+    return false;
+}
+
+
+/**
+ Distribute the objects on the grid, and record all the pairs that may interact,
+ scanning the cells in the same way as setInteractions().
+ */
+void PointGrid::updatePairs()
+{
+    mGrid.clear();
+    mRefs.clear();
+    mIds.clear();
+    pairsPP.clear();
+    pairsPL.clear();
+    pairsLL.clear();
+    
+    for ( unsigned n = 0; n < mPoints.size(); ++n )
+    {
+        FatPoint & p = mPoints[n];
+        p.index = n;
+        point_list(p.pos).push_back(p);
+        mRefs.push_back(p.pos);
+        mIds.push_back(Ident(p.pe.mecable(), p.pe.point()));
+    }
+    
+    for ( unsigned n = 0; n < mLoci.size(); ++n )
+    {
+        FatLocus & l = mLoci[n];
+        l.index = n;
+        locus_list(l.fl.center()).push_back(l);
+        mRefs.push_back(l.fl.pos1());
+        mRefs.push_back(l.fl.pos2());
+        mIds.push_back(Ident(l.fl.fiber(), l.fl.point()));
+    }
+    
+    setSections();
+    for ( unsigned s = 0; s < nbSections; ++s )
+    for ( unsigned indx = sectionInf(s); indx < sectionSup(s); ++indx )
+    {
+        PointGridCell const* base = mGrid.find(indx);
+        
+        if ( !base )
+            continue;
         
-        FatPointList & baseP = point_list(indx);
-        FatLocusList & baseL = locus_list(indx);
+        int * region;
+        int nr = mGrid.getRegion(region, indx);
+        assert_true(region[0] == 0);
+        
+        FatPointList const& baseP = base->point_pane;
+        FatLocusList const& baseL = base->locus_pane;
         
         for ( FatPoint* ii = baseP.begin(); ii < baseP.end(); ++ii )
         {
             for ( FatPoint* jj = ii+1; jj < baseP.end(); ++jj )
-                checkPP(meca, pam, *ii, *jj);
+                if ( nearPP(*ii, *jj) )
+                    pairsPP.push_back(Pair(ii->index, jj->index));
             
             for ( FatLocus* jj = baseL.begin(); jj < baseL.end(); ++jj )
-                checkPL(meca, pam, *ii, *jj);
+                if ( nearPL(*ii, *jj) )
+                    pairsPL.push_back(Pair(ii->index, jj->index));
         }
         
         for ( FatLocus* ii = baseL.begin(); ii < baseL.end(); ++ii )
             for ( FatLocus* jj = ii+1; jj < baseL.end(); ++jj )
-                checkLL(meca, pam, *ii, *jj);
+                if ( nearLL(*ii, *jj) )
+                    pairsLL.push_back(Pair(ii->index, jj->index));
         
         for ( int reg = 1; reg < nr; ++reg )
         {
-            FatPointList & sideP = point_list(indx+region[reg]);
-            FatLocusList & sideL = locus_list(indx+region[reg]);
+            PointGridCell const* side = mGrid.find(indx+region[reg]);
+            
+            if ( !side )
+                continue;
+            
+            FatPointList const& sideP = side->point_pane;
+            FatLocusList const& sideL = side->locus_pane;
             
             for ( FatPoint* ii = baseP.begin(); ii < baseP.end(); ++ii )
             {
                 for ( FatPoint* jj = sideP.begin(); jj < sideP.end(); ++jj )
-                    checkPP(meca, pam, *ii, *jj);
+                    if ( nearPP(*ii, *jj) )
+                        pairsPP.push_back(Pair(ii->index, jj->index));
                 
                 for ( FatLocus* jj = sideL.begin(); jj < sideL.end(); ++jj )
-                    checkPL(meca, pam, *ii, *jj);
+                    if ( nearPL(*ii, *jj) )
+                        pairsPL.push_back(Pair(ii->index, jj->index));
             }
             
             for ( FatLocus* ii = baseL.begin(); ii < baseL.end(); ++ii )
             {
                 for ( FatPoint* jj = sideP.begin(); jj < sideP.end(); ++jj )
-                    checkPL(meca, pam, *jj, *ii);
+                    if ( nearPL(*jj, *ii) )
+                        pairsPL.push_back(Pair(jj->index, ii->index));
                 
                 for ( FatLocus* jj = sideL.begin(); jj < sideL.end(); ++jj )
-                    checkLL(meca, pam, *ii, *jj);
+                    if ( nearLL(*ii, *jj) )
+                        pairsLL.push_back(Pair(ii->index, jj->index));
             }
         }
     }
+    
+    ++nbUpdates;
+    MSG(6, "PointGrid recorded %u pairs\n", nbPairs());
 }
-
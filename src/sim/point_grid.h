@@ -6,9 +6,12 @@
 #include "dim.h"
 #include "vector.h"
 #include "grid.h"
+#include "grid_sparse.h"
 #include "point_exact.h"
 #include "fiber_locus.h"
+#include "point_interpolated.h"
 #include "array.h"
+#include <vector>
 
 class Space;
 class Modulo;
@@ -17,6 +20,16 @@ class Meca;
 class Fiber;
 
 
+///\def POINT_GRID_SPARSE selects a grid that allocates the cells only where objects are added
+/**
+ If POINT_GRID_SPARSE is 1, the cells of PointGrid are allocated by rows
+ when objects are first added to them (see GridSparse).
+ This saves memory if the grid is fine and covers a large Space that is mostly empty.
+ The search for pairs then only visits the rows that were allocated.
+ */
+#define POINT_GRID_SPARSE 0
+
+
 /// represents a PointExact for steric interactions
 class FatPoint
 {
@@ -32,6 +45,9 @@ public:
     
     /// indicates the central Model-point
     PointExact     pe;
+    
+    /// position in the list of PointGrid, used to record pairs
+    unsigned       index;
         
 public:
     
@@ -72,6 +88,9 @@ public:
     /// this represents the entire segment supporting 'pi'
     FiberLocus     fl;
     
+    /// position in the list of PointGrid, used to record pairs
+    unsigned       index;
+    
 public:
     
     FatLocus() {}
@@ -165,6 +184,74 @@ public:
 };
 
 
+/// records the steric interactions found by one thread, to be entered later in Meca
+/**
+ The functions have the same signatures as the corresponding functions of Meca,
+ such that the steric functions of PointGrid can be used with either class.
+ */
+class PointGridBuffer
+{
+    /// the different types of interactions
+    enum LinkType { LONG_LINK, SIDE_SLIDING_LINK, SIDE_SLIDING_LINK2 };
+    
+    /// arguments of one interaction
+    struct Link
+    {
+        LinkType          type;
+        PointInterpolated ia, ib;
+        PointExact        ea, eb;
+        real              len, weight;
+    };
+    
+    /// the interactions, in the order in which they were found
+    Array<Link> links;
+    
+public:
+    
+    /// record Meca::interLongLink()
+    void interLongLink(PointExact const& a, PointExact const& b, real len, real weight)
+    {
+        Link & k = links.new_val();
+        k.type = LONG_LINK;
+        k.ea = a;
+        k.eb = b;
+        k.len = len;
+        k.weight = weight;
+    }
+    
+    /// record Meca::interSideSlidingLink()
+    void interSideSlidingLink(PointInterpolated const& a, PointExact const& b, real len, real weight)
+    {
+        Link & k = links.new_val();
+        k.type = SIDE_SLIDING_LINK;
+        k.ia = a;
+        k.eb = b;
+        k.len = len;
+        k.weight = weight;
+    }
+    
+    /// record Meca::interSideSlidingLink()
+    void interSideSlidingLink(PointInterpolated const& a, PointInterpolated const& b, real len, real weight)
+    {
+        Link & k = links.new_val();
+        k.type = SIDE_SLIDING_LINK2;
+        k.ia = a;
+        k.ib = b;
+        k.len = len;
+        k.weight = weight;
+    }
+    
+    /// number of interactions recorded
+    unsigned size() const { return links.size(); }
+    
+    /// forget all interactions
+    void clear() { links.clear(); }
+    
+    /// enter all the interactions in Meca, in the order in which they were recorded
+    void apply(Meca&) const;
+};
+
+
 /// Divide-and-Conquer to implement steric interactions
 /**
  A divide-and-conquer algorithm is used to find FatPoints that overlap:
@@ -174,33 +261,167 @@ public:
  - Function setStericInteraction() uses mGrid to find pairs of FatPoints that may overlap.
  It then calculates their actual distance, and set a interaction from Meca if necessary
  .
+ 
+ If a skin > 0 is specified with setSkin(), the pairs of objects that are closer
+ than their interaction range extended by the skin are recorded (neighbour lists).
+ The FatPoints are then collected in lists, and at the next time steps, only the
+ recorded pairs are checked. The pairs are recalculated using the grid only when
+ the number of objects has changed, or if any object has moved by more than half the skin,
+ since two objects that were further apart could then have come within range.
+ 
+ If simul:threads > 1, the cells (or the recorded pairs) are divided in contiguous
+ ranges that are checked by different threads. Each thread records its interactions
+ in a PointGridBuffer, and the buffers are entered in Meca in the order of the threads.
+ This gives the same sequence of interactions as a serial calculation.
 */
 class PointGrid
 {
 private:
     
     /// grid for divide-and-conquer strategies:
+#if POINT_GRID_SPARSE
+    GridSparse<DIM, PointGridCell, unsigned> mGrid;
+#else
     Grid<DIM, PointGridCell, unsigned> mGrid;
+#endif
     
     /// max radius that can be included
     real max_diameter;
     
+    /// pair of indices in the lists of FatPoint or FatLocus
+    struct Pair
+    {
+        unsigned a, b;
+        Pair() {}
+        Pair(unsigned x, unsigned y) : a(x), b(y) {}
+    };
+    
+    /// identity of a FatPoint or FatLocus: the Mecable and the index of the point
+    struct Ident
+    {
+        Mecable const* mec;
+        unsigned pti;
+        Ident() {}
+        Ident(Mecable const* m, unsigned p) : mec(m), pti(p) {}
+        bool operator != (Ident const& x) const { return mec != x.mec || pti != x.pti; }
+    };
+    
+    /// distance that objects may move before the pairs are recalculated
+    real mSkin;
+    
+    /// all the FatPoint, if mSkin > 0
+    FatPointList mPoints;
+    
+    /// all the FatLocus, if mSkin > 0
+    FatLocusList mLoci;
+    
+    /// positions of the objects when the pairs were calculated: points, and then both ends of the segments
+    Array<Vector> mRefs;
+    
+    /// identities of the objects when the pairs were calculated: points, and then segments
+    Array<Ident> mIds;
+    
+    /// pairs of FatPoint within range
+    Array<Pair> pairsPP;
+    
+    /// pairs of FatPoint and FatLocus within range
+    Array<Pair> pairsPL;
+    
+    /// pairs of FatLocus within range
+    Array<Pair> pairsLL;
+    
+    /// number of times the pairs were calculated
+    unsigned long nbUpdates;
+    
+    /// one buffer for each thread, used by setInteractionsParallel()
+    std::vector<PointGridBuffer> buffers;
+    
+    /// the parameters used by setInteractionsParallel()
+    PointGridParam const* jobParam;
+    
+    /// number of sections of the grid, set by setSections()
+    unsigned nbSections;
+    
+#if POINT_GRID_SPARSE
+    /// indices of the allocated rows of the grid, in increasing order
+    unsigned const* gridRows;
+    
+    /// index of the first cell of section `s`, which is an allocated row
+    unsigned sectionInf(unsigned s) const { return gridRows[s] * mGrid.nbCells(0); }
+    
+    /// index past the last cell of section `s`
+    unsigned sectionSup(unsigned s) const { return ( gridRows[s] + 1 ) * mGrid.nbCells(0); }
+#else
+    /// index of the first cell of section `s`, which is a single cell
+    unsigned sectionInf(unsigned s) const { return s; }
+    
+    /// index past the last cell of section `s`
+    unsigned sectionSup(unsigned s) const { return s + 1; }
+#endif
+    
+    /// divide the grid into sections of consecutive cells, skipping cells that are not allocated
+    void setSections();
+    
 private:
     
     /// check two Spheres
-    void checkPP(Meca&, PointGridParam const& pam, FatPoint const&, FatPoint const&) const;
+    template < typename MECA >
+    void checkPP(MECA&, PointGridParam const& pam, FatPoint const&, FatPoint const&) const;
     
     /// check Sphere against Line segment
-    void checkPL(Meca&, PointGridParam const& pam, FatPoint const&, FatLocus const&) const;
+    template < typename MECA >
+    void checkPL(MECA&, PointGridParam const& pam, FatPoint const&, FatLocus const&) const;
     
     /// check Line segment against Sphere
-    void checkLL1(Meca&, PointGridParam const& pam, FatLocus const&, FatLocus const&) const;
+    template < typename MECA >
+    void checkLL1(MECA&, PointGridParam const& pam, FatLocus const&, FatLocus const&) const;
     
     /// check Line segment against Sphere
-    void checkLL2(Meca&, PointGridParam const& pam, FatLocus const&, FatLocus const&) const;
+    template < typename MECA >
+    void checkLL2(MECA&, PointGridParam const& pam, FatLocus const&, FatLocus const&) const;
     
     /// check two Line segments
-    void checkLL(Meca&, PointGridParam const& pam, FatLocus const&, FatLocus const&) const;
+    template < typename MECA >
+    void checkLL(MECA&, PointGridParam const& pam, FatLocus const&, FatLocus const&) const;
+    
+    /// true if the two Spheres may come within range
+    bool nearPP(FatPoint const&, FatPoint const&) const;
+    
+    /// true if the Sphere and the Line segment may come within range
+    bool nearPL(FatPoint const&, FatLocus const&) const;
+    
+    /// true if the two Line segments may come within range
+    bool nearLL(FatLocus const&, FatLocus const&) const;
+    
+    /// order the lists of objects, independently of the order in which they were added
+    void sortLists();
+    
+    /// true if an object has moved by more than half the skin since the pairs were calculated
+    bool needUpdate() const;
+    
+    /// distribute the objects on the grid, and record the pairs within range
+    void updatePairs();
+    
+    /// store the centers and reach of the objects of a cell in `buf`
+    static unsigned packCell(std::vector<real>& buf, PointGridCell const&);
+    
+    /// check object `i` of the first cell against object `k` of the second cell
+    template < typename MECA >
+    void checkObjects(MECA&, PointGridParam const& pam, PointGridCell const&, unsigned, PointGridCell const&, unsigned) const;
+    
+    /// check the objects in the sections of the grid [start, end[
+    template < typename MECA >
+    void checkCells(MECA&, PointGridParam const& pam, unsigned start, unsigned end) const;
+    
+    /// check the recorded pairs [start, end[, counting PP, then PL and LL pairs
+    template < typename MECA >
+    void checkPairs(MECA&, PointGridParam const& pam, unsigned start, unsigned end) const;
+    
+    /// function executed by the threads in setInteractionsParallel()
+    static void checkJob(void * arg, unsigned rank, unsigned nbt);
+    
+    /// check the cells or the pairs with multiple threads
+    void setInteractionsParallel(Meca&, PointGridParam const& pam);
 
     
     /// cell corresponding to position `w`
@@ -241,17 +462,26 @@ public:
     /// true if the grid was initialized by calling setGrid()
     bool hasGrid() const    { return mGrid.hasCells(); }
     
-    /// clear the grid
-    void clear()            { mGrid.clear(); }
+    /// set the distance that objects may move before the pairs are recalculated
+    void setSkin(real s);
+    
+    /// clear the grid, or the lists of objects if skin > 0
+    void clear();
     
     /// place PointExact on the grid
-    void add(PointExact const& p, real radius) const;
+    void add(PointExact const& p, real radius);
     
     /// place FiberLocus on the grid
-    void add(FiberLocus const& p, real radius, real extra_range) const;
+    void add(FiberLocus const& p, real radius, real extra_range);
     
     /// enter interactions into Meca between two panes with given stiffness
-    void setInteractions(Meca&, PointGridParam const& pam) const;
+    void setInteractions(Meca&, PointGridParam const& pam);
+    
+    /// number of pairs that are currently recorded, if skin > 0
+    unsigned nbPairs() const { return pairsPP.size() + pairsPL.size() + pairsLL.size(); }
+    
+    /// number of times the pairs were calculated, if skin > 0
+    unsigned long nbPairUpdates() const { return nbUpdates; }
 
 #ifdef DISPLAY
     void display() const
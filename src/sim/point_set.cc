@@ -9,7 +9,6 @@
 #include "random.h"
 #include "cblas.h"
 
-extern Random RNG;
 
 //------------------------------------------------------------------------------
 void PointSet::psConstructor()
@@ -9,7 +9,6 @@
 #include "smath.h"
 #include "random.h"
 
-extern Random RNG;
 
 //optimization for speed:
 #define FASTER_FIBER
@@ -87,12 +86,12 @@ unsigned int RigidFiber::allocatePoints(unsigned int nbp)
 /**
  The argument should be: sc = kT / dt;
  */
-real RigidFiber::addBrownianForces( real* rhs, real sc ) const
+real RigidFiber::addBrownianForces(real const* rnd, real sc, real* rhs) const
 {
     real b = sqrt( 2 * sc / rfMobility );
 
     for ( unsigned jj = 0; jj < DIM*nbPoints(); ++jj )
-        rhs[jj] += b * RNG.gauss();
+        rhs[jj] += b * rnd[jj];
     
     return rfMobility * b;
 }
@@ -164,6 +163,8 @@ void RigidFiber::projectForces(const real* X, real* Y, real s, real*) const
 void RigidFiber::computeTensions(const real*) {} //DIM == 1
 void RigidFiber::makeProjectionDiff(const real*) {} //DIM == 1
 void RigidFiber::addProjectionDiff(const real*, real*) const {} //DIM == 1
+int  RigidFiber::factorizeBand(real const*, real) { return 1; } //DIM == 1
+void RigidFiber::solveBand(real*) const {} //DIM == 1
 
 #endif
 
@@ -113,7 +113,7 @@ public:
     
     
     /// add displacements due to the Brownian motion to rhs[]
-    real        addBrownianForces(real* rhs, real sc) const;
+    real        addBrownianForces(real const* rnd, real sc, real* rhs) const;
     
     /// calculate the speeds from the forces, including projection
     void        setSpeedsFromForces(const real* X, real* Y, real, bool) const;
@@ -126,6 +126,17 @@ public:
     /// add rigidity terms into the matrix
     void        addRigidityMatUp(Matrix &, int offset ) const;
     
+    //--------------------- Banded preconditionner
+    
+    /// rigidity and projection only couple points that are 2 apart
+    unsigned    bandWidth() const { return ( DIM > 1 ) ? 2 : 0; }
+    
+    /// factorize the dynamics including the constraints, as a band matrix
+    int         factorizeBand(real const* band, real sc);
+    
+    /// apply the banded preconditionner: X <- inverse(block) * X
+    void        solveBand(real* X) const;
+    
 };
 
 
@@ -248,3 +248,127 @@ void RigidFiber::addProjectionDiff( const real* X, real* Y ) const
 }
 
 
+//------------------------------------------------------------------------------
+//========================= BANDED PRECONDITIONNER ===========================
+//vvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvv
+
+/*
+ The block of the preconditionner is M = I + s * P * A, where s = sc * rfMobility,
+ A is the (banded) stiffness matrix and P = I - J' * inv( J * J' ) * J.
+ Since J * P = 0, the solution of M * Y = X also verifies J * Y = J * X, and with
+ L = -s * inv( J * J' ) * J * A * Y, the system is equivalent to:
+ 
+     ( I + s * A ) * Y + J' * L = X
+                          J * Y = J * X
+ 
+ J only connects successive points, and if the Lagrange multiplier of segment k
+ is placed after the coordinates of point k, this augmented system is a band matrix
+ of size (DIM+1)*nbPoints()-1, with BAND_KB sub- and super-diagonals.
+ It is factorized by lapack_xgbtrf() with partial pivoting, since its diagonal
+ has zeros, using memory and operations proportional to nbPoints().
+ */
+
+/// number of sub- and super-diagonals of the augmented system
+#define BAND_KB ( ( DIM + 1 ) * 2 + DIM - 1 )
+
+/// leading dimension of the band storage, including space for fill-in
+#define BAND_LD ( 3 * BAND_KB + 1 )
+
+
+int RigidFiber::factorizeBand(real const* band, const real sc)
+{
+    const unsigned bw = bandWidth();
+    const unsigned kd = DIM * ( bw + 1 ) - 1;
+    const unsigned nbp = nbPoints();
+    const unsigned nbs = nbSegments();
+    const unsigned dim = ( DIM + 1 ) * nbp - 1;
+    const real s = sc * rfMobility;
+    
+    assert_true( BAND_KB == ( DIM + 1 ) * bw + DIM - 1 );
+    
+    // element (i, j) of the augmented system is stored in mat[i-j+BAND_LD*j]:
+    real * ab = allocateBlock(BAND_LD*dim+dim, dim);
+    real * mat = ab + 2 * BAND_KB;
+    blas_xzero(BAND_LD*dim, ab);
+    
+    // I + s * A, from the upper band of A:
+    for ( unsigned q = 0; q < nbp; ++q )
+    {
+        for ( unsigned e = 0; e < DIM; ++e )
+        {
+            const unsigned jj = DIM * q + e;
+            const unsigned JJ = ( DIM + 1 ) * q + e;
+            mat[BAND_LD*JJ] += 1.0;
+            for ( unsigned p = ( q > bw ? q - bw : 0 ); p <= q; ++p )
+            {
+                for ( unsigned d = 0; d < DIM; ++d )
+                {
+                    const unsigned ii = DIM * p + d;
+                    if ( ii > jj )
+                        break;
+                    const unsigned II = ( DIM + 1 ) * p + d;
+                    const real a = s * band[kd+ii-jj+(kd+1)*jj];
+                    mat[II-JJ+BAND_LD*JJ] += a;
+                    if ( II != JJ )
+                        mat[JJ-II+BAND_LD*II] += a;
+                }
+            }
+        }
+    }
+    
+    // constraints: ( J * Y )[k] = diff[k] . ( Y[k+1] - Y[k] ), and J'
+    for ( unsigned k = 0; k < nbs; ++k )
+    {
+        const unsigned LL = ( DIM + 1 ) * k + DIM;
+        for ( unsigned d = 0; d < DIM; ++d )
+        {
+            const real x = rfDiff[DIM*k+d];
+            const unsigned I0 = ( DIM + 1 ) * k + d;
+            const unsigned I1 = I0 + DIM + 1;
+            mat[LL-I0+BAND_LD*I0] = -x;
+            mat[LL-I1+BAND_LD*I1] =  x;
+            mat[I0-LL+BAND_LD*LL] = -x;
+            mat[I1-LL+BAND_LD*LL] =  x;
+        }
+    }
+    
+    int info = 0;
+    lapack_xgbtrf(dim, dim, BAND_KB, BAND_KB, ab, BAND_LD, pivot(), &info);
+    return info;
+}
+
+
+/**
+ The right-hand side of the augmented system is assembled in the memory
+ allocated after the band factors, such that different fibers may be
+ processed concurrently.
+ */
+void RigidFiber::solveBand(real* X) const
+{
+    const unsigned nbp = nbPoints();
+    const unsigned nbs = nbSegments();
+    const unsigned dim = ( DIM + 1 ) * nbp - 1;
+    real * vec = block() + BAND_LD * dim;
+    
+    for ( unsigned p = 0; p < nbp; ++p )
+        for ( unsigned d = 0; d < DIM; ++d )
+            vec[(DIM+1)*p+d] = X[DIM*p+d];
+    
+    for ( unsigned k = 0; k < nbs; ++k )
+    {
+        real const* x = X + DIM * k;
+        real const* dif = rfDiff + DIM * k;
+        real j = 0;
+        for ( unsigned d = 0; d < DIM; ++d )
+            j += dif[d] * ( x[DIM+d] - x[d] );
+        vec[(DIM+1)*k+DIM] = j;
+    }
+    
+    int info = 0;
+    lapack_xgbtrs('N', dim, BAND_KB, BAND_KB, 1, block(), BAND_LD, pivot(), vec, dim, &info);
+    assert_true( info == 0 );
+    
+    for ( unsigned p = 0; p < nbp; ++p )
+        for ( unsigned d = 0; d < DIM; ++d )
+            X[DIM*p+d] = vec[(DIM+1)*p+d];
+}
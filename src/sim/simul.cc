@@ -193,7 +193,9 @@ void Simul::prepare(Space * spc)
     // this is necessary for diffusion in Field:
     fields.prepare();
     
+    fibers.prepare(properties);
     couples.prepare(properties);
+    singles.prepare(properties);
 
     sReady = true;
 }
@@ -281,6 +281,9 @@ public:
     
     /// print time
     void      reportTime(std::ostream&) const;
+    
+    /// report the occupancy of the memory pool
+    void      reportMemory(std::ostream&) const;
    
     /// analyse the network connectivity to identify isolated sub-networks
     void      analyzeClusters() const;
@@ -309,6 +312,9 @@ public:
     /// print number of kinks in each class of Fiber
     void      reportFiberSegments(std::ostream&) const;
     
+    /// print the number of segments painted on the FiberGrid
+    void      reportFiberGrid(std::ostream&) const;
+    
     /// print number of fibers according to dynamic state of end
     void      reportFiberDynamic(std::ostream&, FiberEnd) const;
     
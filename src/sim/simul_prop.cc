@@ -10,8 +10,8 @@
 #include "glossary.h"
 #include "property_list.h"
 #include "random.h"
+#include "thread_pool.h"
 
-extern Random RNG;
 extern bool functionKey[];
 
 
@@ -26,6 +26,13 @@ void SimulProp::clear()
     tolerance         = 0.05;
     acceptable_rate   = 0.5;
     precondition      = 1;
+    precondition_reuse = 0;
+    precondition_drift = 0.1;
+    warm_start        = false;
+    split_solve       = false;
+    solver_log        = "";
+    solver_log_binary = false;
+    threads           = 1;
     random_seed       = 0;
     steric            = 0;
  
@@ -35,7 +42,11 @@ void SimulProp::clear()
     steric_stiffness_pull[1] = 100;
 
     steric_max_range  = -1;
+    steric_skin       = 0;
     binding_grid_step = -1;
+    binding_grid_skin = 0;
+    binding_batch     = false;
+    parallel_step     = false;
     
     strict            = 0;
     verbose           = 0;
@@ -62,6 +73,15 @@ void SimulProp::read(Glossary& glos)
     glos.set(tolerance,         "tolerance");
     glos.set(acceptable_rate,   "acceptable_rate");
     glos.set(precondition,      "precondition");
+    glos.set(precondition_reuse, "precondition_reuse");
+    glos.set(precondition_drift, "precondition_drift");
+    glos.set(warm_start,        "warm_start");
+    glos.set(split_solve,       "split_solve");
+    glos.set(solver_log,        "solver_log");
+    glos.set(solver_log_binary, "solver_log", 1);
+    
+    if ( glos.set(threads,      "threads") )
+        POOL.resize(threads);
     
     glos.set(steric,                   "steric");
     glos.set(steric_stiffness_push[0], "steric", 1);
@@ -69,8 +89,12 @@ void SimulProp::read(Glossary& glos)
     glos.set(steric_stiffness_push, 2, "steric_stiffness_push");
     glos.set(steric_stiffness_pull, 2, "steric_stiffness_pull");
     glos.set(steric_max_range,         "steric_max_range");
+    glos.set(steric_skin,              "steric_skin");
 
     glos.set(binding_grid_step, "binding_grid_step");
+    glos.set(binding_grid_skin, "binding_grid_skin");
+    glos.set(binding_batch,     "binding_batch");
+    glos.set(parallel_step,     "parallel_step");
 
     // these parameters are not written:
     glos.set(strict,            "strict");
@@ -122,6 +146,17 @@ void SimulProp::complete(SimulProp const* sp, PropertyList* plist)
 
         if ( kT <= 0 )
             throw InvalidParameter("simul:kT must be > 0");
+        
+        if ( precondition < 0  ||  precondition > 3 )
+            throw InvalidParameter("simul:precondition must be 0, 1, 2 or 3");
+        
+        if ( precondition_drift < 0 )
+            throw InvalidParameter("simul:precondition_drift must be >= 0");
+
+#if FIBER_GRID_COMPACT
+        if ( binding_grid_skin > 0 )
+            throw InvalidParameter("simul:binding_grid_skin cannot be used with FIBER_GRID_COMPACT");
+#endif
 
         // set a valid seed if necessary:
         if ( random_seed == 0 )
@@ -153,11 +188,22 @@ void SimulProp::write_data(std::ostream & os) const
     write_param(os, "tolerance",       tolerance);
     write_param(os, "acceptable_rate", acceptable_rate);
     write_param(os, "precondition",    precondition);
+    write_param(os, "precondition_reuse", precondition_reuse);
+    write_param(os, "precondition_drift", precondition_drift);
+    write_param(os, "warm_start",      warm_start);
+    write_param(os, "split_solve",     split_solve);
+    if ( solver_log.size() )
+        write_param(os, "solver_log",  solver_log, solver_log_binary);
+    write_param(os, "threads",         threads);
     write_param(os, "random_seed",     random_seed);
     os << std::endl;
     write_param(os, "steric", steric, steric_stiffness_push[0], steric_stiffness_pull[0]);
     write_param(os, "steric_max_range",  steric_max_range);
+    write_param(os, "steric_skin",       steric_skin);
     write_param(os, "binding_grid_step", binding_grid_step);
+    write_param(os, "binding_grid_skin", binding_grid_skin);
+    write_param(os, "binding_batch",     binding_batch);
+    write_param(os, "parallel_step",     parallel_step);
     write_param(os, "verbose", verbose);
     os << std::endl;
 
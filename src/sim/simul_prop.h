@@ -138,13 +138,124 @@ public:
     /**
      The accepted values of \a precondition are:
      - 0 : never use preconditionning
-     - 1 : always use preconditionning
-     - 2 : try the two methods, and use the fastest one
+     - 1 : use the explicit inverse of the diagonal blocks
+     - 2 : use the LU factorization of the diagonal blocks, applied by triangular solves
+     - 3 : same as 2, but Fibers use a band factorization, with memory and work proportional to their number of points
      .
+     With `verbose > 0`, the time spent building and applying the preconditionner
+     is reported at each time step.
      
      <em>default value = 1</em>
      */
     int       precondition;
+    
+    
+    /// Maximum number of time steps during which a preconditionner block may be reused
+    /**
+     By default, the preconditionner is calculated at every time step.
+     If \a precondition_reuse > 0, the block of each object is kept and reused
+     for up to \a precondition_reuse time steps, and is recalculated earlier if:
+     - the number of points of the object has changed,
+     - the interactions of the object have changed by more than \a precondition_drift,
+     - the number of iterations needed by the solver has increased substantially.
+     .
+     This is only an approximation in the preconditionner, and it does not affect
+     the precision of the solution, which is always set by \a tolerance.
+     
+     <em>default value = 0</em>
+     */
+    unsigned  precondition_reuse;
+    
+    
+    /// Relative change in the stiffness of an object's interactions that triggers the recalculation of its preconditionner block
+    /**
+     The change is measured on the diagonal terms of the matrix of interactions.
+     This is used only if \a precondition_reuse > 0.
+     
+     <em>default value = 0.1</em>
+     */
+    real      precondition_drift;
+    
+    
+    /// If true, the solution of the previous time step is used as initial guess for the solver
+    /**
+     By default, the iterative solver starts from zero at each time step.
+     With \a warm_start, the displacement of each object calculated at the
+     previous step is used instead, if the object's number of points is unchanged.
+     This may reduce the number of iterations in systems that relax slowly.
+     With `verbose > 0`, the fraction of the initial guess that was recovered
+     is reported with the number of iterations.
+     
+     <em>default value = false</em>
+     */
+    bool      warm_start;
+    
+    
+    /// If true, the independent subsystems are solved separately
+    /**
+     With \a split_solve, the objects are divided into groups that are not
+     connected by any interaction (Couple, Single, steric link, etc.),
+     and the linear system of each group is solved independently,
+     with its own convergence criteria.
+     The groups are distributed over the \a threads.
+     If any group fails to converge, the entire system is solved together as usual.
+     With `verbose > 0`, the number of groups is reported.
+     
+     <em>default value = false</em>
+     */
+    bool      split_solve;
+    
+    
+    /// Name of a file in which Meca records the work of the solver at each time step
+    /**
+     Syntax:
+     @code
+     solver_log = FILE_NAME, BINARY
+     @endcode
+     If \a solver_log is not empty, one record is written for each call to the solver,
+     containing the following values:
+     - step: index of the call
+     - size: number of degrees of freedom of the system
+     - nnz_B, nnz_C: number of elements in the matrices of interactions
+     - precond: the preconditionning method
+     - built: number of preconditionner blocks calculated
+     - noise: the Brownian noise level
+     - threshold: the residual required for convergence
+     - iter: number of iterations
+     - residual: the residual achieved
+     - subsystems: number of subsystems that were solved (see \a split_solve)
+     - t_assembly: time spent setting the interactions
+     - t_forces: time spent calculating the forces and the right-hand side
+     - t_build: time spent building the preconditionner
+     - t_apply: time spent applying the preconditionner
+     - t_solve: time spent in the iterative solver, including t_apply
+     - t_finish: time spent updating the objects
+     .
+     The times are wall-times in milli-seconds.
+     If BINARY is true, each record is made of 17 values of type double,
+     in the order given above, and in the native byte order.
+     Otherwise, the values are separated by commas, after a line with their names.
+     The file is appended if \a append_file is true.
+     
+     <em>default value = "" (no file)</em>
+     */
+    std::string solver_log;
+    
+    /// If true, \a solver_log is written in binary format
+    bool      solver_log_binary;
+
+    
+    /// Number of threads used to parallelize some of the calculations
+    /**
+     With \a threads > 1, cytosim distributes some independent calculations,
+     such as the construction of the preconditionner, on several threads.
+     The results do not depend on the number of threads.
+     The main thread is counted, and one should set \a threads to the number
+     of cores available to cytosim on the machine.
+     
+     <em>default value = 1</em>
+     */
+    unsigned  threads;
 
     
     /// A flag to control the engine that implement steric interactions between objects
@@ -180,6 +291,16 @@ public:
      */
     real      steric_max_range;
     
+    /// distance that objects may move before the pairs of steric interactions are recalculated
+    /**
+     If \a steric_skin > 0, the pairs of objects that are closer than their interaction range
+     extended by \a steric_skin are recorded, and at the following time steps, only these pairs are checked.
+     The pairs are recalculated when any object has moved by more than half \a steric_skin (see PointGrid).
+     This is faster if the objects move slowly, but \a steric_max_range must be larger by \a steric_skin.
+     With the default value (0), all pairs are found using the grid at every time step.
+     */
+    real      steric_skin;
+    
     
     /// Lattice size used to determine the attachment of Hand to Fiber
     /**
@@ -196,6 +317,43 @@ public:
      */
     real      binding_grid_step;
     
+    /// distance that Fibers may move before the FiberGrid is repainted
+    /**
+     If \a binding_grid_skin > 0, the segments of the Fibers are painted on the grid with
+     a width extended by \a binding_grid_skin, and at each time step, only the segments
+     that have moved by more than this distance are repainted (see FiberGrid).
+     The segments of a Fiber are all repainted if the Fiber has gained or lost points.
+     This can be much faster, particularly in 3D, but the lists of segments are longer.
+     With the default value (0), the grid is cleared and repainted at every time step.
+     A value > 0 is rejected if cytosim was compiled with FIBER_GRID_COMPACT = 1.
+     */
+    real      binding_grid_skin;
+    
+    /// if true, the attachment of Hands is done for all Hands together, after the Couples and Singles have moved
+    /**
+     If \a binding_batch is set, the Hands that are ready to attach are recorded,
+     and processed after all Couples and Singles have been stepped, cell by cell (see FiberGrid).
+     This gives the same attachment statistics, but is faster if many Hands attach at each step.
+     The results are not identical however, since random numbers are used differently.
+     */
+    bool      binding_batch;
+    
+    /// if true, the Fibers, Couples and Singles are stepped on multiple threads (see \a threads)
+    /**
+     If \a parallel_step is set, the lists of objects are divided into sections,
+     which are stepped concurrently, each with its own random number generator.
+     The transfers of objects between lists, the updates of the lists of Hands
+     attached to each Fiber, the nucleations and the deletions of Fibers are
+     applied afterwards, in the order of the sections.
+     The results are thus reproducible and do not depend on the number of threads,
+     but they are different from those obtained with the default (false).
+     \a binding_batch is not used in this mode.
+     If any Couple or Single has a Hand that modifies the Fibers (`cut`, `rescue`
+     or an addictive `nucleate`), these objects are stepped serially,
+     and Fibers with `glue` are also stepped serially.
+     */
+    bool      parallel_step;
+    
     /// level of verbosity
     int           verbose;
 
@@ -36,6 +36,7 @@ void Simul::report(std::ostream& out, std::string const& str, Glossary& opt) con
  `solid`             | Position of center and first point of solids
  `sphere`            | Position of center and first point of spheres
  `time`              | Time
+ `memory`            | Occupancy of the memory pool of Hands, Couples and Singles
  `parameters`        | All object properties
  
  
@@ -50,6 +51,7 @@ void Simul::report(std::ostream& out, std::string const& str, Glossary& opt) con
  `fiber:forces`      | Position of model points and Forces acting on model points
  `fiber:tensions`    | Internal stress along fibers
  `fiber:clusters`    | Clusters made of fibers connected by Couples
+ `fiber:grid`        | Number of segments painted on the grid used for binding
  `bead:all`          | Position of beads
  `bead:singles`      | Number of Beads with no single attached, 1 single attached etc.
  `single:all`        | Position and force of singles
@@ -93,7 +95,9 @@ void Simul::report(std::ostream& out, std::string const& what, std::string const
             return reportFiberForces(out);
         if ( who == "clusters" )
             return reportClusters(out, 1);
-        throw InvalidSyntax("I only know fiber: ends, points, speckles, segments, dynamics, lengths, length_distribution, tensions, forces, clusters");
+        if ( who == "grid" )
+            return reportFiberGrid(out);
+        throw InvalidSyntax("I only know fiber: ends, points, speckles, segments, dynamics, lengths, length_distribution, tensions, forces, clusters, grid");
     }
     if ( what == "bead" )
     {
@@ -157,6 +161,12 @@ void Simul::report(std::ostream& out, std::string const& what, std::string const
             return reportTime(out);
         throw InvalidSyntax("I only know `time'");
     }
+    if ( what == "memory" )
+    {
+        if ( who.empty() )
+            return reportMemory(out);
+        throw InvalidSyntax("I only know `memory'");
+    }
     if ( what == "parameters" )
     {
         if ( who.empty() )
@@ -176,6 +186,15 @@ void Simul::reportTime(std::ostream& out) const
     out << std::left << std::setw(9) << simTime() << std::endl;
 }
 
+
+/**
+ Export the number of slots used and free in the Slab of Hands, Couples and Singles
+ */
+void Simul::reportMemory(std::ostream& out) const
+{
+    Hand::slab().report(out);
+}
+
 //------------------------------------------------------------------------------
 #pragma mark -
 
@@ -289,6 +308,25 @@ void Simul::reportFiberSegments(std::ostream& out) const
 }
 
 
+/**
+ Export the number of segments painted on the FiberGrid at the last time step,
+ and the average number of segments painted per step.
+ With simul:binding_grid_skin=0, all segments are painted at every step.
+ */
+void Simul::reportFiberGrid(std::ostream& out) const
+{
+    out << "%segments painted avg_painted steps" << std::endl;
+    unsigned long cnt = fiberGrid.nbCalls();
+    real avg = 0;
+    if ( cnt > 0 )
+        avg = fiberGrid.nbSegmentsRepaintedTotal() / real(cnt);
+    out << std::fixed;
+    out.precision(2);
+    out << std::setw(9) << fiberGrid.nbSegmentsPainted() << " " << std::setw(7) << fiberGrid.nbSegmentsRepainted();
+    out << " " << std::setw(11) << avg << " " << std::setw(5) << cnt << std::endl;
+}
+
+
 /**
  Export number of fiber, classified according to dynamic state of one end
  */
@@ -51,19 +51,19 @@ real Simul::estimateStericRange() const
      + 2 * ( len / 2 ) since len/2 is the distance between the center of the segment
      and its most distal point.
      */
-    ran =  len + 2*ran;
+    ran =  len + 2*ran + prop->steric_skin;
     
     
     for ( Sphere const* sp=spheres.first(); sp; sp=sp->next() )
     {
-        real d = 2 * sp->radius();
+        real d = 2 * sp->radius() + prop->steric_skin;
         if ( sp->prop->steric && ran < d )
             ran = d;
     }
     
     for ( Bead const* bd=beads.first(); bd; bd=bd->next() )
     {
-        real d = 2 * bd->radius();
+        real d = 2 * bd->radius() + prop->steric_skin;
         if ( bd->prop->steric && ran < d )
             ran = d;
     }
@@ -74,7 +74,7 @@ real Simul::estimateStericRange() const
         {
             for ( unsigned p = 0; p < so->nbPoints(); ++p )
             {
-                real d = 2 * so->radius(p);
+                real d = 2 * so->radius(p) + prop->steric_skin;
                 if ( ran < d )
                     ran = d;
             }
@@ -135,6 +135,7 @@ void Simul::setStericInteractions(Meca& meca) const
         setStericGrid(sSpace);
 
     // clear grid
+    stericGrid.setSkin(prop->steric_skin);
     stericGrid.clear();
         
     // distribute Fiber-points on the grid
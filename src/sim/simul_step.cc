@@ -100,6 +100,9 @@ void Simul::step()
         setFiberGrid(space());
     
     //MSG(9, "grid range = %.2f nm\n", 1000 * HandProp::binding_range_max);
+    fiberGrid.setSkin(prop->binding_grid_skin);
+    fiberGrid.setBatch(prop->binding_batch);
+    fiberGrid.setConcurrent(prop->parallel_step);
     fiberGrid.paintGrid(fibers.first(), 0, HandProp::binding_range_max);
     
     
@@ -120,9 +123,26 @@ void Simul::step()
         }
     }
     
+#endif
+
+#ifdef TEST_NEARBY
+    
+    if ( HandProp::binding_range_max > 0 )
+    {
+        // test distances below and above the range of the grid:
+        const real D[] = { 0.5, 1, 4 };
+        for ( unsigned int cnt = 0; cnt < TEST_NEARBY; ++cnt )
+        {
+            Vector pos = space()->randomPlace();
+            for ( int d = 0; d < 3; ++d )
+                fiberGrid.testNearby(stdout, pos, D[d] * HandProp::binding_range_max, fibers.first());
+        }
+    }
+    
 #endif
        
     couples.step(fibers, fiberGrid);
     singles.step(fibers, fiberGrid);
+    fiberGrid.attachPending();
 }
 
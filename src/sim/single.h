@@ -82,6 +82,12 @@ public:
     ///destructor
     virtual ~Single();
     
+    /// allocate memory from Hand::slab(), such that a Single and its Hand are contiguous
+    static void * operator new(size_t s)               { return Hand::slab().allocate(s); }
+    
+    /// return memory to Hand::slab()
+    static void   operator delete(void * p, size_t s)  { Hand::slab().release(p, s); }
+    
     //--------------------------------------------------------------------------
     
     ///a reference to the Hand
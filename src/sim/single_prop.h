@@ -23,6 +23,7 @@ class SingleProp : public Property
     friend class Single;
     friend class Wrist;
     friend class WristLong;
+    friend class SingleSet;
 
 public:
     
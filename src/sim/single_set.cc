@@ -8,6 +8,8 @@
 #include "simul.h"
 #include "wrist.h"
 #include "wrist_long.h"
+#include "nucleator.h"
+#include "thread_pool.h"
 
 //------------------------------------------------------------------------------
 /**
@@ -22,8 +24,21 @@ Property* SingleSet::newProperty(const std::string& kd, const std::string& nm, G
 }
 
 //------------------------------------------------------------------------------
+
+void SingleSet::prepare(PropertyList& properties)
+{
+    parallel = simul.prop->parallel_step && parallelPrepare(properties);
+}
+
+
 void SingleSet::step(FiberSet const&, FiberGrid const& fgrid)
 {
+    if ( parallel )
+    {
+        stepParallel(fgrid);
+        return;
+    }
+    
     /*
      ATTENTION: we have multiple lists, and Objects are automatically 
      transfered from one list to another if their Hand bind or unbind.
@@ -61,6 +76,109 @@ void SingleSet::step(FiberSet const&, FiberGrid const& fgrid)
     }
 }
 
+//------------------------------------------------------------------------------
+#pragma mark - Parallel Step
+
+/**
+ The Hands that modify the Fibers cannot be stepped concurrently (see HandProp::concurrent()).
+ */
+bool SingleSet::parallelPrepare(PropertyList& properties)
+{
+    PropertyList plist = properties.find_all("single");
+    
+    for ( PropertyList::const_iterator n = plist.begin(); n != plist.end(); ++n )
+    {
+        SingleProp const * p = static_cast<SingleProp const*>(*n);
+        if ( !p->hand_prop->concurrent() )
+        {
+            MSG.warning("single:%s cannot be stepped in parallel\n", p->name().c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+
+/**
+ This steps the Singles of section `s` of each list, in the same order as step().
+ The lists are not modified, and the Singles that have changed Fiber are recorded.
+ */
+void SingleSet::stepSection(const unsigned s, FiberGrid const& grid)
+{
+    Random * rng = threadRNG;
+    threadRNG = sectionRNG() + s;
+    
+    std::vector<Single*>& chg = changed[s];
+    chg.clear();
+    
+    Node * const endF = sections[0][s+1];
+    for ( Node * n = sections[0][s]; n != endF; n = n->next() )
+    {
+        Single * obj = static_cast<Single*>(n);
+        obj->stepFree(grid);
+        if ( obj->attached() )
+            chg.push_back(obj);
+    }
+    
+    Node * const endA = sections[1][s+1];
+    for ( Node * n = sections[1][s]; n != endA; n = n->next() )
+    {
+        Single * obj = static_cast<Single*>(n);
+        Fiber const* fib = obj->fiber();
+        obj->stepAttached();
+        if ( obj->fiber() != fib )
+            chg.push_back(obj);
+    }
+    
+    threadRNG = rng;
+}
+
+
+void SingleSet::stepJob(void * arg, unsigned rank, unsigned nbt)
+{
+    SingleSet * set = static_cast<SingleSet*>(arg);
+    unsigned start, end;
+    ThreadPool::partition(NB_SECTIONS, rank, nbt, start, end);
+    for ( unsigned s = start; s < end; ++s )
+        set->stepSection(s, *set->jobGrid);
+}
+
+
+/**
+ This follows CoupleSet::stepParallel(): the lists are divided into NB_SECTIONS
+ sections, each stepped with its own Random Number Generator, and the transfers
+ between the lists are applied afterwards in the order of the sections.
+ */
+void SingleSet::stepParallel(FiberGrid const& grid)
+{
+    sectionRNG();
+    divideList(fList, NB_SECTIONS, sections[0]);
+    divideList(aList, NB_SECTIONS, sections[1]);
+    
+    jobGrid = &grid;
+    deferLinks(true);
+    FiberBinder::deferLinks = true;
+    
+    POOL.run(stepJob, this);
+    
+    FiberBinder::deferLinks = false;
+    deferLinks(false);
+    jobGrid = 0;
+    
+    for ( unsigned s = 0; s < NB_SECTIONS; ++s )
+    {
+        std::vector<Single*>& chg = changed[s];
+        for ( std::vector<Single*>::iterator i = chg.begin(); i != chg.end(); ++i )
+        {
+            (*i)->hand()->relinkBinder();
+            relink(*i);
+        }
+    }
+    
+    Nucleator::nucleatePending();
+}
+
+
 //------------------------------------------------------------------------------
 void SingleSet::erase()
 {
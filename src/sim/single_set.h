@@ -38,10 +38,35 @@ private:
     /// register a Single into the list
     void         link(Object *);
     
+    
+    /// flag to step the Singles on multiple threads
+    bool               parallel;
+    
+    /// sections[L][s] is the first Single of section `s` of list L, in the order F, A
+    Node *             sections[2][NB_SECTIONS+1];
+    
+    /// the Singles with a Hand that has changed Fiber in each section
+    std::vector<Single*> changed[NB_SECTIONS];
+    
+    /// the FiberGrid used by stepJob()
+    FiberGrid const*   jobGrid;
+    
+    /// true if all the Singles can be stepped concurrently
+    bool         parallelPrepare(PropertyList& properties);
+    
+    /// Monte-Carlo step for the Singles of section `s`
+    void         stepSection(unsigned s, FiberGrid const&);
+    
+    /// call stepSection() for a fraction of the sections
+    static void  stepJob(void*, unsigned rank, unsigned nbt);
+    
+    /// Monte-Carlo step on multiple threads
+    void         stepParallel(FiberGrid const&);
+
 public:
         
     ///creator
-    SingleSet(Simul& s) : ObjectSet(s), fList(this), aList(this) {}
+    SingleSet(Simul& s) : ObjectSet(s), fList(this), aList(this), parallel(false), jobGrid(0) {}
     
     ///destructor
     virtual      ~SingleSet() {}
@@ -95,6 +120,9 @@ public:
     /// delete objects, or put them back in normal list
     void          thaw(bool erase);
 
+    /// prepare for step()
+    void          prepare(PropertyList& properties);
+    
     /// Monte-Carlo step
     void          step(FiberSet const&, FiberGrid const&);
     
@@ -11,7 +11,6 @@
 #include "meca.h"
 #include "simul.h"
 #include "space.h"
-extern Random RNG;
 
 #if ( DIM == 3 )
 #   include "quaternion.h"
@@ -745,13 +744,13 @@ void Solid::prepareMecable()
 }
 
 
-real Solid::addBrownianForces(real* rhs, real sc) const
+real Solid::addBrownianForces(real const* rnd, real sc, real* rhs) const
 {    
     // Brownian amplitude
     real b = sqrt( 2 * sc * soDrag / nbPoints() );
 
     for ( unsigned int jj = 0; jj < DIM*nbPoints(); ++jj )
-        rhs[jj] += b * RNG.gauss();
+        rhs[jj] += b * rnd[jj];
     
     return b / soDrag;
 }
@@ -8,7 +8,6 @@
 #include "messages.h"
 #include "iowrapper.h"
 #include "meca.h"
-extern Random RNG;
 
 
 Space::Space(const SpaceProp* p) 
@@ -7,7 +7,6 @@
 #include "smath.h"
 #include "meca.h"
 
-extern Random RNG;
 
 SpaceSphere::SpaceSphere(const SpaceProp* p)
 : Space(p)
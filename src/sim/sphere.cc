@@ -16,7 +16,6 @@
 #include "simul.h"
 #include "sim.h"
 
-extern Random RNG;
 
 //------------------- construction and destruction ---------------------------
 
@@ -231,7 +230,7 @@ void Sphere::prepareMecable()
 
 //------------------------------------------------------------------------------
 
-real Sphere::addBrownianForces(real* rhs, real sc) const
+real Sphere::addBrownianForces(real const* rnd, real sc, real* rhs) const
 {
     real bT = sqrt( 2 * sc / spMobility );
     real bS = sqrt( 2 * sc / prop->point_mobility );
@@ -245,7 +244,7 @@ real Sphere::addBrownianForces(real* rhs, real sc) const
     
     for ( unsigned dp = DIM*nbRefPts; dp < DIM*nbPoints(); dp+=DIM )
     {
-        Vector fp = Vector::randGauss(bS);
+        Vector fp = bS * Vector(rnd+dp);
         F += fp;
         
         rhs[dp  ] += fp.XX;
@@ -272,24 +271,24 @@ real Sphere::addBrownianForces(real* rhs, real sc) const
     for ( unsigned dp = DIM; dp < DIM*nbRefPts; dp+=DIM )
     {
 #if   ( DIM == 2 )
-        rhs[dp]   += R.XX - T * psPos[dp+1] + bT * RNG.gauss();
-        rhs[dp+1] += R.YY + T * psPos[dp  ] + bT * RNG.gauss();
+        rhs[dp]   += R.XX - T * psPos[dp+1] + bT * rnd[dp  ];
+        rhs[dp+1] += R.YY + T * psPos[dp  ] + bT * rnd[dp+1];
         F += vecProd(T, Vector(psPos[dp]-cx, psPos[dp+1]-cy));
 #elif ( DIM == 3 )
-        rhs[dp  ] += R.XX + T.YY * psPos[dp+2] - T.ZZ * psPos[dp+1] + bT * RNG.gauss();
-        rhs[dp+1] += R.YY + T.ZZ * psPos[dp  ] - T.XX * psPos[dp+2] + bT * RNG.gauss();
-        rhs[dp+2] += R.ZZ + T.XX * psPos[dp+1] - T.YY * psPos[dp  ] + bT * RNG.gauss();
+        rhs[dp  ] += R.XX + T.YY * psPos[dp+2] - T.ZZ * psPos[dp+1] + bT * rnd[dp  ];
+        rhs[dp+1] += R.YY + T.ZZ * psPos[dp  ] - T.XX * psPos[dp+2] + bT * rnd[dp+1];
+        rhs[dp+2] += R.ZZ + T.XX * psPos[dp+1] - T.YY * psPos[dp  ] + bT * rnd[dp+2];
         F += vecProd(T, Vector(psPos[dp]-cx, psPos[dp+1]-cy, psPos[dp+2]-cz));
 #endif
     }
     
 #if   ( DIM == 2 )
-    rhs[0] -= F.XX + bT * RNG.gauss();
-    rhs[1] -= F.YY + bT * RNG.gauss();
+    rhs[0] -= F.XX + bT * rnd[0];
+    rhs[1] -= F.YY + bT * rnd[1];
 #elif ( DIM == 3 )
-    rhs[0] -= F.XX + bT * RNG.gauss();
-    rhs[1] -= F.YY + bT * RNG.gauss();
-    rhs[2] -= F.ZZ + bT * RNG.gauss();
+    rhs[0] -= F.XX + bT * rnd[0];
+    rhs[1] -= F.YY + bT * rnd[1];
+    rhs[2] -= F.ZZ + bT * rnd[2];
 #endif
     
     return std::min(bT*spMobility, bS*prop->point_mobility);
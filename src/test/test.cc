@@ -5,7 +5,6 @@
 
 #include "array.h"
 #include "random.h"
-extern Random RNG;
 
 
 int comp_ints(const void * ap, const void * bp)
@@ -13,7 +13,6 @@ using namespace gle;
 
 #define DISPLAY
 #include "grid.h"
-extern Random RNG;
 
 //area of the grid
 const int    range = 5;
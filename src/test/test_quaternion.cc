@@ -8,7 +8,6 @@
 #include "matrix3.h"
 #include "vecprint.h"
 
-extern Random RNG;
 
 
 void testRotation(Vector3 vec, real angle)
@@ -1,10 +1,10 @@
 // Cytosim was created by Francois Nedelec. Copyright 2007-2017 EMBL.
 
 #include "random.h"
+#include "philox.h"
 #include <cstring>
 #include "tictoc.h"
 
-extern Random RNG;
 
 
 
@@ -164,6 +164,202 @@ void testPoisson(real E, unsigned int N)
 }
 
 
+//==========================================================================
+
+/// compare Philox4x32-10 with the known-answer vectors of Random123
+void testPhiloxKAT()
+{
+    const uint32_t ctr[3][4] = {
+        { 0, 0, 0, 0 },
+        { 0xffffffff, 0xffffffff, 0xffffffff, 0xffffffff },
+        { 0x243f6a88, 0x85a308d3, 0x13198a2e, 0x03707344 } };
+    const uint32_t key[3][2] = {
+        { 0, 0 },
+        { 0xffffffff, 0xffffffff },
+        { 0xa4093822, 0x299f31d0 } };
+    const uint32_t ans[3][4] = {
+        { 0x6627e8d5, 0xe169c58d, 0xbc57ac4c, 0x9b00dbd8 },
+        { 0x408f276d, 0x41c83b0e, 0xa20bc7c6, 0x6d5451fd },
+        { 0xd16cfe09, 0x94fdcceb, 0x5001e420, 0x24126ea1 } };
+    
+    for ( int i = 0; i < 3; ++i )
+    {
+        uint32_t res[4];
+        Philox::bijection(ctr[i], key[i], res);
+        bool ok = ( 0 == memcmp(res, ans[i], sizeof(res)) );
+        printf("Philox4x32-10 known-answer %i: %08x %08x %08x %08x  %s\n",
+               i, res[0], res[1], res[2], res[3], ok?"OK":"FAILED");
+    }
+}
+
+
+/// check that the streams are reproducible, and print the moments of some distributions
+void testPhilox(const unsigned N)
+{
+    Philox a(7, 3, 12), b(7, 3, 13), c;
+    
+    // stream (seed, step, id) is reproducible, in any order:
+    real x = a.preal();
+    b.preal();
+    c.seed(7, 3, 12);
+    printf("Philox reproducible: %s\n", x == c.preal() ? "OK" : "FAILED");
+    
+    real sg = 0, sg2 = 0, se = 0, su = 0, sp = 0, sb = 0;
+    for ( unsigned i = 0; i < N; ++i )
+    {
+        real g = a.gauss();
+        sg  += g;
+        sg2 += g * g;
+        se  += b.exponential();
+        su  += c.preal();
+        sp  += a.poisson(3.5);
+        sb  += b.binomial(10, 0.3);
+    }
+    printf("gauss       mean %+.4f  var %.4f\n", sg/N, sg2/N-(sg/N)*(sg/N));
+    printf("exponential mean %.4f\n", se/N);
+    printf("preal       mean %.4f\n", su/N);
+    printf("poisson(3.5)     mean %.4f\n", sp/N);
+    printf("binomial(10,0.3) mean %.4f\n", sb/N);
+    
+    real vec[7];
+    a.gauss_array(7, vec);
+    printf("gauss_array:");
+    for ( int i = 0; i < 7; ++i )
+        printf(" %+.3f", vec[i]);
+    printf("\n");
+    
+    TicToc::tic();
+    uint32_t u = 0;
+    for ( unsigned i = 0; i < 16*N; ++i )
+        u ^= a.pint();
+    TicToc::toc("Philox pint");
+    TicToc::tic();
+    for ( unsigned i = 0; i < 16*N; ++i )
+        u ^= RNG.pint();
+    TicToc::toc("Random pint");
+    printf(" %u\n", u & 1);
+}
+
+
+/// cumulative distribution function of the normal law N(0,1)
+real cdfGauss(real x)
+{
+    return 0.5 * erfc(-x * M_SQRT1_2);
+}
+
+
+/// cumulative distribution function of the exponential law Exp(1)
+real cdfExponential(real x)
+{
+    return x > 0 ? 1 - exp(-x) : 0;
+}
+
+
+/**
+ Print the chi-square statistics of the `N` values in `vec`, distributed in `nbin` bins
+ of width `delta` starting at `inf`, and two bins for the values outside this range.
+ The expected counts are calculated from the cumulative distribution `cdf`,
+ and bins with less than 5 expected values are skipped.
+ */
+void chiSquare(const char str[], const unsigned N, real const* vec,
+               const real inf, const real delta, const unsigned nbin, real (*cdf)(real))
+{
+    unsigned * cnt = new unsigned[nbin+2];
+    for ( unsigned b = 0; b < nbin+2; ++b )
+        cnt[b] = 0;
+    
+    // bin 0 is below `inf`, and bin nbin+1 is above the last bin:
+    for ( unsigned i = 0; i < N; ++i )
+    {
+        real x = floor( ( vec[i] - inf ) / delta );
+        if ( x < 0 )
+            ++cnt[0];
+        else if ( x >= nbin )
+            ++cnt[nbin+1];
+        else
+            ++cnt[1+(unsigned)x];
+    }
+    
+    real chi = 0;
+    int dof = -1;
+    for ( unsigned b = 0; b < nbin+2; ++b )
+    {
+        real a = ( b > 0 ) ? cdf(inf+(b-1)*delta) : 0;
+        real c = ( b <= nbin ) ? cdf(inf+b*delta) : 1;
+        real e = N * ( c - a );
+        if ( e >= 5 )
+        {
+            chi += ( cnt[b] - e ) * ( cnt[b] - e ) / e;
+            ++dof;
+        }
+    }
+    delete[] cnt;
+    
+    // the 99% quantile of the chi-square distribution, using the Wilson-Hilferty approximation:
+    real z = 1 - 2.0 / ( 9 * dof ) + 2.326 * sqrt( 2.0 / ( 9 * dof ) );
+    real q99 = dof * z * z * z;
+    printf("%s chi-square %8.2f for %i degrees of freedom, 99%% quantile %.2f : %s\n",
+           str, chi, dof, q99, chi < q99 ? "pass" : "FAIL");
+}
+
+
+/// print the moments of the ziggurat generators, compare their speed, and test their distribution
+void testZiggurat(const unsigned N)
+{
+    real * vec = new real[N];
+    
+    TicToc::tic();
+    for ( unsigned i = 0; i < N; ++i )
+        vec[i] = RNG.gauss();
+    TicToc::toc("gauss      ");
+    
+    TicToc::tic();
+    RNG.gauss_array(N, vec);
+    TicToc::toc("gauss_array");
+    printf("\n");
+    
+    real s1 = 0, s2 = 0, s4 = 0;
+    for ( unsigned i = 0; i < N; ++i )
+    {
+        real x = vec[i];
+        s1 += x;
+        s2 += x * x;
+        s4 += x * x * x * x;
+    }
+    printf("gauss_array        mean %+.4f  var %.4f  kurtosis %.4f\n", s1/N, s2/N, s4/N);
+    chiSquare("gauss_array", N, vec, -4, 0.1, 80, cdfGauss);
+    
+    TicToc::tic();
+    RNG.exponential_array(N, vec);
+    TicToc::toc("exponential_array");
+    printf("\n");
+    
+    s1 = 0; s2 = 0;
+    for ( unsigned i = 0; i < N; ++i )
+    {
+        s1 += vec[i];
+        s2 += vec[i] * vec[i];
+    }
+    printf("exponential_array  mean %.4f  var %.4f\n", s1/N, s2/N-(s1/N)*(s1/N));
+    chiSquare("exponential_array", N, vec, 0, 0.25, 40, cdfExponential);
+    
+    // fraction of values in some intervals, compared to the expected values:
+    unsigned cnt[3] = { 0 };
+    RNG.gauss_array(N, vec);
+    for ( unsigned i = 0; i < N; ++i )
+    {
+        real a = fabs(vec[i]);
+        cnt[0] += ( a < 1 );
+        cnt[1] += ( a > 2 );
+        cnt[2] += ( a > 3.442619855899 );
+    }
+    printf("P(|x|<1) = %.5f (0.68269)  P(|x|>2) = %.5f (0.04550)  P(|x|>R) = %.6f (0.000576)\n",
+           cnt[0]/(real)N, cnt[1]/(real)N, cnt[2]/(real)N);
+    
+    delete[] vec;
+}
+
+
 //==========================================================================
 //test 3 methods to generate a random event time, when the rate varies in time
 // F. Nedelec, Oct 2005
@@ -285,7 +481,16 @@ int main(int argc, char* argv[])
 #endif
     
     printf("sizeof(uint32_t) = %lu\n", sizeof(uint32_t));
-    if ( argc == 1 )
+    if ( argc > 1  &&  0 == strcmp(argv[1], "philox") )
+    {
+        testPhiloxKAT();
+        testPhilox(1000000);
+    }
+    else if ( argc > 1  &&  0 == strcmp(argv[1], "ziggurat") )
+    {
+        testZiggurat(1<<24);
+    }
+    else if ( argc == 1 )
     {
         for ( int kk=0; kk < 11; ++kk )
         {
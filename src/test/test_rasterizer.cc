@@ -11,7 +11,6 @@
 #include "random.h"
 #include "rasterizer.h"
 
-extern Random RNG;
 
 //===================================================================
 
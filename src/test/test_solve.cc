@@ -10,7 +10,6 @@
 #include "matrix2.h"
 #include "random.h"
 
-extern Random RNG;
 
 //a point in space:
 GLdouble Gx=1, Gy=1, Gz;
@@ -10,7 +10,6 @@
 #include "smath.h"
 #include "vector.h"
 #include "random.h"
-extern Random RNG;
 
 #include "space_prop.h"
 #include "space.h"
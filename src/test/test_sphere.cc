@@ -6,7 +6,6 @@
 #include "pointsonsphere.h"
 #include "glapp.h"
 #include "gle.h"
-extern Random RNG;
 
 int nPoints = 12;
 PointsOnSphere S, T;